@@ -2,81 +2,33 @@
 #define AI_ENGINE_H
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <random>
 #include <string>
+#include <thread>
 #include <tuple>
-#include <unordered_map>
 #include <vector>
 
+#include "book.h"
+#include "eval_hash.h"
+#include "pawn_hash.h"
+#include "psqt.h"
+#include "tbprobe.h"
+#include "tt.h"
+
 namespace py = pybind11;
 using namespace std;
 
-// Piece values
-static const int PIECE_VALUE[6] = {100, 320, 330, 500, 900, 20000};
-
-// --- Piece-Square Tables ---
-const int PST_P[64] = {0,   0,  0,  0,   0,  0,  0,   0,  50, 50, 50, 50, 50,
-                       50,  50, 50, 10,  10, 20, 30,  30, 20, 10, 10, 5,  5,
-                       10,  25, 25, 10,  5,  5,  0,   0,  0,  20, 20, 0,  0,
-                       0,   5,  -5, -10, 0,  0,  -10, -5, 5,  5,  10, 10, -20,
-                       -20, 10, 10, 5,   0,  0,  0,   0,  0,  0,  0,  0};
-
-const int PST_N[64] = {-50, -40, -30, -30, -30, -30, -40, -50, -40, -20, 0,
-                       0,   0,   0,   -20, -40, -30, 0,   10,  15,  15,  10,
-                       0,   -30, -30, 5,   15,  20,  20,  15,  5,   -30, -30,
-                       0,   15,  20,  20,  15,  0,   -30, -30, 5,   10,  15,
-                       15,  10,  5,   -30, -40, -20, 0,   5,   5,   0,   -20,
-                       -40, -50, -40, -30, -30, -30, -30, -40, -50};
-
-const int PST_B[64] = {-20, -10, -10, -10, -10, -10, -10, -20, -10, 0,   0,
-                       0,   0,   0,   0,   -10, -10, 0,   5,   10,  10,  5,
-                       0,   -10, -10, 5,   5,   10,  10,  5,   5,   -10, -10,
-                       0,   10,  10,  10,  10,  0,   -10, -10, 10,  10,  10,
-                       10,  10,  10,  -10, -10, 5,   0,   0,   0,   0,   5,
-                       -10, -20, -10, -10, -10, -10, -10, -10, -20};
-
-const int PST_R[64] = {0,  0, 0, 0, 0, 0, 0, 0,  5,  10, 10, 10, 10, 10, 10, 5,
-                       -5, 0, 0, 0, 0, 0, 0, -5, -5, 0,  0,  0,  0,  0,  0,  -5,
-                       -5, 0, 0, 0, 0, 0, 0, -5, -5, 0,  0,  0,  0,  0,  0,  -5,
-                       0,  0, 0, 5, 5, 0, 0, 0,  0,  5,  5,  0,  0,  5,  5,  0};
-
-const int PST_Q[64] = {
-    -20, -10, -10, -5, -5, -10, -10, -20, -10, 0,   0,   0,  0,  0,   0,   -10,
-    -10, 0,   5,   5,  5,  5,   0,   -10, -5,  0,   5,   5,  5,  5,   0,   -5,
-    0,   0,   5,   5,  5,  5,   0,   -5,  -10, 5,   5,   5,  5,  5,   0,   -10,
-    -10, 0,   5,   0,  0,  0,   0,   -10, -20, -10, -10, -5, -5, -10, -10, -20};
-
-const int PST_K_mid[64] = {
-    -30, -40, -40, -50, -50, -40, -40, -30, -30, -40, -40, -50, -50,
-    -40, -40, -30, -30, -40, -40, -50, -50, -40, -40, -30, -30, -40,
-    -40, -50, -50, -40, -40, -30, -20, -30, -30, -40, -40, -30, -30,
-    -20, -10, -20, -20, -20, -20, -20, -20, -10, 20,  20,  0,   0,
-    0,   0,   20,  20,  20,  30,  10,  0,   0,   10,  30,  20};
-
-const int PST_K_end[64] = {
-    -50, -40, -30, -20, -20, -30, -40, -50, -30, -20, -10, 0,   0,
-    -10, -20, -30, -30, -10, 20,  30,  30,  20,  -10, -30, -30, -10,
-    30,  40,  40,  30,  -10, -30, -30, -10, 30,  40,  40,  30,  -10,
-    -30, -30, -10, 20,  30,  30,  20,  -10, -30, -30, -30, 0,   0,
-    0,   0,   -30, -30, -50, -30, -30, -30, -30, -30, -30, -50};
-
-static unordered_map<int, int> MVV_LVA = {{P, 1}, {N, 2}, {B, 3},
-                                          {R, 4}, {Q, 5}, {K, 6}};
-
-static const int TT_EXACT = 0;
-static const int TT_ALPHA = 1;
-static const int TT_BETA = 2;
-
-struct TTEntry {
-  U64 full_key; // full Zobrist key for collision detection
-  int score;
-  int depth;
-  int flag;
-};
+// Mate at ply p scores MATE_SCORE - p; anything beyond MATE_BOUND is a mate
+static const int MATE_SCORE = 20000;
+static const int MATE_BOUND = 15000;
 
 // --- Passed pawn bonuses by rank (from White's perspective) ---
 static const int PASSED_PAWN_BONUS[8] = {0, 10, 20, 30, 50, 70, 90, 0};
@@ -84,15 +36,88 @@ static const int PASSED_PAWN_BONUS[8] = {0, 10, 20, 30, 50, 70, 90, 0};
 class AlphaBetaEngine {
 public:
   int max_depth;
-  double time_limit;
-  vector<tuple<int, int, int, int>> move_history;
-
-  unordered_map<U64, TTEntry> transposition_table;
-  vector<pair<MoveFull, MoveFull>> killer_moves;
-  unordered_map<U64, int> history;
-  int nodes_searched;
-  double start_time;
+  double time_limit; // hard cap in seconds, also used when no clock is set
+
+  // Game clock for the side to move, in seconds (0 = not playing on a
+  // clock), and an optional node budget for reproducible runs (counting
+  // the nodes of every thread)
+  double clock = 0.0;
+  double increment = 0.0;
+  int moves_to_go = 0; // 0 = sudden death
+  U64 node_limit = 0;
+  int threads = 1;     // Lazy SMP: the main search plus threads - 1 helpers
+  bool verbose = true; // print the [AI-BB] line after each iteration
+  bool persistent = true; // keep TT and history between moves of a game
+  bool ponder = false; // keep searching the expected reply after a move
+  bool use_book = true; // play from the opening book, if one is loaded
+  bool use_nnue = true; // evaluate with the NNUE network, if one is loaded
+
+  // Shared by the main search and its helper threads
+  shared_ptr<TranspositionTable> tt = make_shared<TranspositionTable>();
+  shared_ptr<atomic<bool>> stop = make_shared<atomic<bool>>(false);
+  // Nodes of all threads, added to every 2048 nodes, for node_limit
+  shared_ptr<atomic<U64>> shared_nodes = make_shared<atomic<U64>>(0);
+  vector<unique_ptr<AlphaBetaEngine>> helpers;
+
+  shared_ptr<PolyglotBook> book; // memory-mapped, shared between engines
+  mt19937_64 book_rng{random_device{}()};
+
+  shared_ptr<NnueNetwork> nnue; // shared between engines like the book
+  // Network the caches were made by. Holding it keeps its address from
+  // being reused by a later load, which would pass for the same network.
+  shared_ptr<NnueNetwork> search_nnue;
+
+  // Tablebases of this search: kept alive while it probes them, even if
+  // set_syzygy_path loads others meanwhile
+  shared_ptr<SyzygyTablebases> tb = SyzygyTablebases::current();
+  // Root moves that keep the tablebase result (empty: search all moves)
+  vector<Move> root_tb_moves;
+
+  PawnHashTable pawn_hash; // per thread: helpers keep their own
+  EvalHashTable eval_hash;
+
+  vector<pair<Move, Move>> killer_moves;
+
+  // Triangular PV table: pv_table[ply] holds the best line found from ply
+  // on, pv_length[ply] its end. prev_pv is the last completed iteration's
+  // line, searched first in the next one while follow_pv is set.
+  static const int MAX_PLY = 128;
+  // Tablebase wins rank below every mate score; both lie beyond TB_BOUND
+  static const int TB_WIN_SCORE = MATE_BOUND - MAX_PLY;
+  static const int TB_BOUND = TB_WIN_SCORE - MAX_PLY;
+  Move pv_table[MAX_PLY][MAX_PLY];
+  int pv_length[MAX_PLY];
+  vector<Move> prev_pv;
+  vector<Move> best_pv; // PV of the last finished search, for Python
+  bool follow_pv = false;
+  int history[64][64];
+  U64 nodes_searched;
+  U64 nodes_shared = 0; // part of nodes_searched already in shared_nodes
+  U64 tb_hits = 0;
+  U64 eval_probes = 0, eval_hits = 0; // eval cache use, to size it
+  atomic<double> start_time{0.0}; // reset by a ponder hit mid-search
   vector<vector<int>> LMR_table;
+  int helper_id = 0; // 0 for the main search
+
+  // Background search started by start_search
+  thread search_thread;
+  atomic<bool> searching{false};
+  ChessEngine search_board;
+  Move best_result = NO_MOVE;
+  // What wait() returns: the last search's move, kept while pondering
+  Move result = NO_MOVE;
+  bool result_pending = false; // best_result not yet taken by wait()
+  // Null until a callback is set: helpers are built on the search thread,
+  // where touching None's refcount without the GIL would race. The search
+  // thread only reads it with the GIL held, after checking has_callback.
+  py::object on_iteration;
+  atomic<bool> has_callback{false};
+
+  // Pondering: the moves still expected before a ponder hit
+  vector<Move> ponder_moves;
+  U64 ponder_key = 0; // position the ponder search is running on
+  bool ponder_hit = false;
+  atomic<bool> pondering{false}; // no time limit until the hit
 
   AlphaBetaEngine(int depth = 5, double time_limit = 5.0) {
     max_depth = depth;
@@ -104,20 +129,77 @@ public:
         LMR_table[d][m] = (int)(0.5 + log(d) * log(m) / 2.0);
       }
     }
-    _reset_search_state();
+    new_game();
+  }
+
+  // Helper thread engine: shares the TT, stop flag and node count of
+  // `main`, but keeps its own killers and history
+  AlphaBetaEngine(const AlphaBetaEngine &main, int helper_id)
+      : max_depth(main.max_depth), time_limit(main.time_limit),
+        persistent(main.persistent), tt(main.tt), stop(main.stop),
+        shared_nodes(main.shared_nodes), LMR_table(main.LMR_table),
+        helper_id(helper_id) {
+    verbose = false;
+    memset(history, 0, sizeof(history));
+    _reset_thread_state();
+  }
+
+  // Open a Polyglot book; an empty path unloads it
+  void load_book(const string &path) {
+    book = path.empty() ? nullptr : PolyglotBook::open_shared(path);
+  }
+
+  // Load a HalfKP .nnue network; an empty path unloads it, leaving the
+  // classical evaluation
+  void load_nnue(const string &path) {
+    _abort_search(); // the search board points into the network
+    nnue = path.empty() ? nullptr : NnueNetwork::open_shared(path);
   }
 
   void record_move(py::tuple move) {
-    move_history.push_back({move[0].cast<int>(), move[1].cast<int>(),
-                            move[2].cast<int>(), move[3].cast<int>()});
+    _ponder_record(move[0].cast<int>() * 8 + move[1].cast<int>(),
+                   move[2].cast<int>() * 8 + move[3].cast<int>());
+  }
+
+  // Forget everything learned so far: call between games
+  void new_game() {
+    _abort_search();
+    ponder_moves.clear();
+    ponder_hit = false;
+    pondering = false;
+    tt->clear();
+    eval_hash.clear();
+    memset(history, 0, sizeof(history));
+    helpers.clear();
+    _reset_search_state();
   }
 
+  // Per-move setup. Unless `persistent` is off, TT entries from earlier
+  // moves are kept (the new generation makes them the first to be
+  // replaced) and history is scaled down so it still guides ordering
+  // without outweighing what this search learns.
   void _reset_search_state() {
-    transposition_table.clear();
-    killer_moves.assign(max_depth + 16, {MoveFull{-1, -1, -1, -1, ""},
-                                         MoveFull{-1, -1, -1, -1, ""}});
-    history.clear();
+    if (!persistent)
+      tt->clear();
+    tt->new_search();
+    stop->store(false);
+    shared_nodes->store(0);
+    _reset_thread_state();
+  }
+
+  void _reset_thread_state() {
+    if (!persistent)
+      memset(history, 0, sizeof(history));
+    for (auto &row : history)
+      for (int &h : row)
+        h /= 8;
+    killer_moves.assign(MAX_PLY, {NO_MOVE, NO_MOVE});
+    aborted = false;
+    prev_pv.clear();
     nodes_searched = 0;
+    nodes_shared = 0;
+    tb_hits = 0;
+    eval_probes = eval_hits = 0;
     start_time = 0.0;
   }
 
@@ -128,226 +210,584 @@ public:
   }
 
   // =============================================
-  // 1. ZOBRIST HASHING
+  // TIME MANAGEMENT
   // =============================================
-  U64 _get_hash(const ChessEngine &engine) {
-    U64 h = 0;
-    for (int color = 0; color < 2; color++) {
-      for (int piece = 0; piece < 6; piece++) {
-        U64 bb = engine.pieces[color][piece];
-        while (bb) {
-          int sq = bb_ctzll(bb);
-          h ^= zobrist_pieces[color][piece][sq];
-          bb &= bb - 1;
-        }
-      }
+  // The soft limit is the planned time for this move: no new iteration
+  // starts after it (scaled by best-move stability and score trend). The
+  // hard limit aborts the search mid-iteration. All three are set from
+  // the Python thread while a ponder search runs, hence atomic.
+  atomic<double> soft_limit{0.0};
+  atomic<double> hard_limit{0.0};
+  atomic<bool> use_clock{false}; // searching on a game clock
+  bool aborted = false; // set once the running iteration must be dropped
+
+  void _init_time_manager() {
+    use_clock = clock > 0.0;
+    if (!use_clock) {
+      soft_limit = hard_limit = time_limit;
+      return;
     }
-    if (engine.turn_col == BLACK)
-      h ^= zobrist_side;
-    if (engine.ep_square >= 0 && engine.ep_square < 64)
-      h ^= zobrist_ep[engine.ep_square];
-    h ^= zobrist_castling[engine.castling & 0xF];
-    return h;
+    int mtg = moves_to_go > 0 ? min(moves_to_go, 40) : 30;
+    double reserve = max(0.0, clock * 0.9 - 0.05); // move overhead
+    double planned = clock / mtg + increment * 0.8;
+    soft_limit = min({planned, reserve, time_limit});
+    hard_limit = min({planned * 4.0, reserve, time_limit});
+  }
+
+  // Polled every 2048 nodes and between root moves
+  bool _check_abort() {
+    U64 total = shared_nodes->fetch_add(nodes_searched - nodes_shared,
+                                        memory_order_relaxed) +
+                nodes_searched - nodes_shared;
+    nodes_shared = nodes_searched;
+    if (!aborted &&
+        (stop->load(memory_order_relaxed) ||
+         (node_limit && total >= node_limit) ||
+         (!pondering.load(memory_order_acquire) &&
+          get_time() - start_time > hard_limit)))
+      aborted = true;
+    return aborted;
+  }
+
+  // Whether to start another iteration. On a clock the budget shrinks
+  // while the best move stays the same and grows when the score drops.
+  bool _soft_time_left(int stable_iterations, int score_drop) {
+    if (pondering.load(memory_order_acquire))
+      return true;
+    double elapsed = get_time() - start_time;
+    if (!use_clock)
+      return elapsed < soft_limit;
+
+    double scale = 1.0;
+    if (stable_iterations >= 4)
+      scale = 0.5;
+    else if (stable_iterations >= 2)
+      scale = 0.75;
+    if (score_drop > 50)
+      scale *= 2.0;
+    else if (score_drop > 20)
+      scale *= 1.5;
+    return elapsed < soft_limit * scale;
   }
 
   // =============================================
   // ITERATIVE DEEPENING
   // =============================================
+  // Blocking search: start_search + wait
   py::object get_best_move(ChessEngine &engine) {
+    start_search(engine);
+    return wait();
+  }
+
+  // Search a copy of `engine` on a native thread and return immediately.
+  // `callback(depth, score, nodes, pv)` is called with the GIL held after
+  // every completed iteration of the main search.
+  void start_search(const ChessEngine &engine,
+                    py::object callback = py::none()) {
+    // After a ponder hit the running search already is this search
+    if (ponder_hit && search_thread.joinable() &&
+        ponder_key == engine.hash_key) {
+      _set_callback(callback);
+      _end_ponder();
+      return;
+    }
+    _abort_search();
+    ponder_moves.clear();
+    ponder_hit = false;
+    pondering = false;
+    // Cached evals belong to one evaluator: switching starts afresh
+    shared_ptr<NnueNetwork> net = use_nnue ? nnue : nullptr;
+    if (net != search_nnue) {
+      new_game();
+      search_nnue = net;
+    }
+    _set_callback(callback);
+    search_board = engine;
+    if (_play_book_move())
+      return;
+    _launch_search(false);
+  }
+
+  // A book hit is the result straight away, with no search
+  bool _play_book_move() {
+    if (!use_book || !book)
+      return false;
+    Move m = book->pick(search_board, book_rng);
+    if (m == NO_MOVE)
+      return false;
     _reset_search_state();
+    best_result = m;
+    result_pending = true;
+    prev_pv = {m};
+    if (verbose)
+      cout << "  [AI-BB] book move " << move_to_uci(m) << "\n";
+    return true;
+  }
+
+  void _launch_search(bool ponder_search) {
+    _reset_search_state();
+    pondering = ponder_search;
+    result_pending = !ponder_search;
+    _init_time_manager();
+    search_board.attach_nnue(search_nnue.get());
+    tb = SyzygyTablebases::current();
+    root_tb_moves = tb->root_moves(search_board);
     start_time = get_time();
+    searching = true;
+    search_thread = thread([this]() {
+      best_result = _search(search_board);
+      searching = false;
+    });
+  }
+
+  // True once the search has finished (or if none was started). A ponder
+  // search running after it does not count until a ponder hit.
+  bool poll() const {
+    return !searching || (pondering.load(memory_order_acquire) && !ponder_hit);
+  }
+
+  // Block until the search finishes, with the GIL released, and return the
+  // best move (sr, sc, tr, tc) or None. While a ponder search runs this is
+  // the cached result of the last search; the ponder search is started
+  // once, by the first wait() for that result.
+  py::object wait() {
+    if (ponder_hit)
+      _end_ponder(); // hit without a start_search: finish on the clock
+    if (result_pending) {
+      if (search_thread.joinable()) {
+        py::gil_scoped_release release;
+        search_thread.join();
+      }
+      result_pending = false;
+      result = best_result;
+      best_pv = prev_pv;
+      if (ponder && result != NO_MOVE)
+        _start_ponder(result);
+    }
+    return result != NO_MOVE ? py::object(_move_to_py(result))
+                             : py::object(py::none());
+  }
+
+  // =============================================
+  // PONDERING
+  // =============================================
+  // After returning `best`, search the position after `best` and the reply
+  // the TT expects, with no time limit. record_move() follows the game:
+  // if both moves are played it is a ponder hit, the clock starts and the
+  // next start_search() adopts the running search, with its callback and
+  // time limits; any other move stops it. Either way the TT keeps what the ponder search found.
+  void _start_ponder(Move best) {
+    ChessEngine board = search_board;
+    board.make_move_fast(best);
+
+    Move reply = NO_MOVE;
+    TTEntry tte;
+    if (best_pv.size() > 1 && best_pv[0] == best)
+      reply = best_pv[1];
+    else if (tt->probe(board.hash_key, tte))
+      reply = tte.move();
+    MoveList moves;
+    board.get_legal_moves(moves);
+    bool legal = find(moves.begin(), moves.end(), reply) != moves.end();
+    if (reply == NO_MOVE || !legal)
+      return;
+    board.make_move_fast(reply);
+
+    ponder_moves = {best, reply};
+    ponder_key = board.hash_key;
+    ponder_hit = false;
+    _set_callback(py::none());
+    search_board = board;
+    _launch_search(true);
+  }
+
+  void _ponder_record(int from, int to) {
+    if (ponder_hit || ponder_moves.empty())
+      return;
+    Move expected = ponder_moves.front();
+    if (move_from(expected) != from || move_to(expected) != to) {
+      _abort_search();
+      ponder_moves.clear();
+      return;
+    }
+    ponder_moves.erase(ponder_moves.begin());
+    if (ponder_moves.empty()) {
+      ponder_hit = true;
+      start_time = get_time(); // our clock runs from here
+    }
+  }
+
+  // Put the adopted ponder search on the clock: the limits are computed
+  // now, from the clock as set for this move, before pondering ends
+  void _end_ponder() {
+    ponder_hit = false;
+    result_pending = true; // the ponder search now is the search
+    _init_time_manager();
+    pondering.store(false, memory_order_release);
+  }
+
+  // Called with the GIL held, also while the search thread runs
+  void _set_callback(py::object callback) {
+    on_iteration = callback;
+    has_callback.store(!callback.is_none(), memory_order_release);
+  }
+
+  // Ask a running search to finish; its best move so far stays available
+  // through wait()
+  void stop_search() { stop->store(true); }
 
-    MoveFull best_move = {-1, -1, -1, -1, ""};
-    bool has_best = false;
+  ~AlphaBetaEngine() { _abort_search(); }
+
+  // Stop and join a background search, if any. The GIL is released while
+  // joining so a callback waiting for it cannot deadlock.
+  void _abort_search() {
+    if (search_thread.joinable()) {
+      stop->store(true);
+      py::gil_scoped_release release;
+      search_thread.join();
+    }
+  }
+
+  Move _search(ChessEngine &engine) {
+    // Lazy SMP: helpers run their own iterative deepening on a copy of the
+    // board and only communicate through the shared TT. Even helpers start
+    // one ply deeper so threads spread over neighbouring depths.
+    helpers.resize(max(threads, 1) - 1);
+    vector<thread> pool;
+    for (size_t i = 0; i < helpers.size(); i++) {
+      if (!helpers[i])
+        helpers[i].reset(new AlphaBetaEngine(*this, (int)i + 1));
+      AlphaBetaEngine &h = *helpers[i];
+      h.max_depth = max_depth;
+      h.hard_limit = 1e30; // helpers stop when the main search does
+      h.persistent = persistent;
+      h.tb = tb;
+      h.root_tb_moves = root_tb_moves;
+      h._reset_thread_state();
+      h.start_time = start_time.load();
+      pool.emplace_back([&h, engine]() mutable {
+        h._iterative_deepening(engine, 1 + (h.helper_id & 1), MAX_SEARCH_DEPTH);
+      });
+    }
+
+    Move best_move = _iterative_deepening(engine, 1, max_depth);
+
+    stop->store(true);
+    for (auto &t : pool)
+      t.join();
+    for (auto &h : helpers) {
+      nodes_searched += h->nodes_searched;
+      tb_hits += h->tb_hits;
+      eval_probes += h->eval_probes;
+      eval_hits += h->eval_hits;
+    }
+
+    if (best_move == NO_MOVE && !root_tb_moves.empty())
+      best_move = root_tb_moves[0]; // a fallback that keeps the TB result
+    if (best_move == NO_MOVE) {
+      // fallback legal move
+      MoveList moves;
+      engine.get_legal_moves(moves);
+      if (moves.count > 0)
+        best_move = moves.moves[0];
+    }
+    return best_move;
+  }
+
+  // Progress report for the main search: log line plus Python callback
+  void _report_iteration(int depth, int score) {
+    if (verbose && !pondering.load(memory_order_acquire)) {
+      cout << "  [AI-BB] depth=" << depth << "  score=" << score
+           << "  nodes=" << nodes_searched
+           << "  time=" << (get_time() - start_time) << "s  pv";
+      for (Move m : prev_pv)
+        cout << " " << move_to_uci(m);
+      cout << "\n";
+    }
+
+    if (!has_callback.load(memory_order_acquire))
+      return;
+    py::gil_scoped_acquire gil;
+    if (!on_iteration || on_iteration.is_none())
+      return;
+    try {
+      py::list pv;
+      for (Move m : prev_pv)
+        pv.append(_move_to_py(m));
+      on_iteration(depth, score, nodes_searched, pv);
+    } catch (py::error_already_set &e) {
+      e.discard_as_unraisable("AlphaBetaEngine search callback");
+    }
+  }
+
+  static const int MAX_SEARCH_DEPTH = 64;
+
+  Move _iterative_deepening(ChessEngine &engine, int first_depth,
+                            int last_depth) {
+    Move best_move = NO_MOVE;
     int prev_score = 0;
     int asp_window = 50;
+    int stable_iterations = 0;
+
+    MoveList root_moves;
+    engine.get_legal_moves(root_moves);
+    int root_count =
+        root_tb_moves.empty() ? root_moves.count : (int)root_tb_moves.size();
 
-    for (int depth = 1; depth <= max_depth; depth++) {
-      if (get_time() - start_time > time_limit)
+    for (int depth = first_depth; depth <= last_depth; depth++) {
+      if (_check_abort())
         break;
 
       int alpha = (depth >= 4) ? prev_score - asp_window : -999999;
       int beta = (depth >= 4) ? prev_score + asp_window : 999999;
 
       auto res = _root_search(engine, depth, alpha, beta);
-      MoveFull move = res.first;
+      Move move = res.first;
       int score = res.second;
 
-      if (score <= alpha || score >= beta) {
+      if (!aborted && (score <= alpha || score >= beta)) {
         res = _root_search(engine, depth, -999999, 999999);
         move = res.first;
         score = res.second;
       }
+      // An interrupted iteration is incomplete: keep the previous result
+      if (aborted)
+        break;
 
+      int score_drop = depth > first_depth ? prev_score - score : 0;
+      stable_iterations = move == best_move ? stable_iterations + 1 : 0;
       prev_score = score;
-      if (get<0>(move) != -1) {
-        best_move = move;
-        has_best = true;
-      }
+      best_move = move;
+      prev_pv.assign(pv_table[0], pv_table[0] + pv_length[0]);
 
-      cout << "  [AI-BB] depth=" << depth << "  score=" << score
-           << "  nodes=" << nodes_searched
-           << "  time=" << (get_time() - start_time) << "s\n";
+      if (helper_id == 0)
+        _report_iteration(depth, score);
 
-      if (abs(score) >= 15000)
+      if (abs(score) >= MATE_BOUND)
+        break;
+      if (helper_id == 0 && use_clock && root_count == 1)
+        break; // forced move, no need to spend the clock
+      if (helper_id == 0 && !_soft_time_left(stable_iterations, score_drop))
         break;
     }
+    return best_move;
+  }
 
-    if (has_best) {
-      return py::make_tuple(get<0>(best_move), get<1>(best_move),
-                            get<2>(best_move), get<3>(best_move));
-    } else {
-      // fallback legal move
-      auto pms = engine.get_pseudo_moves(engine.turn_col);
-      for (auto &m : pms) {
-        auto st = engine.save_state();
-        int tc = engine.turn_col;
-        engine.make_move_fast(get<0>(m), get<1>(m), get<2>(m), get<3>(m),
-                              get<4>(m));
-        bool in_chk = engine.is_attacked(bb_ctzll(engine.pieces[tc][K]),
-                                         engine.enemy_col(tc));
-        engine.restore_state(st, tc);
-        if (!in_chk) {
-          return py::make_tuple(get<0>(m), get<1>(m), get<2>(m), get<3>(m));
-        }
-      }
-    }
-    return py::none();
+  // Principal variation of the last finished search as move tuples
+  py::list get_pv() const {
+    py::list pv;
+    for (Move m : best_pv)
+      pv.append(_move_to_py(m));
+    return pv;
+  }
+
+  static py::tuple _move_to_py(Move m) {
+    int from = move_from(m), to = move_to(m);
+    return py::make_tuple(from / 8, from % 8, to / 8, to % 8);
   }
 
   // =============================================
   // 4. PVS — ROOT SEARCH
   // =============================================
-  pair<MoveFull, int> _root_search(ChessEngine &engine, int depth, int alpha,
+  pair<Move, int> _root_search(ChessEngine &engine, int depth, int alpha,
                                    int beta) {
-    int color = engine.turn_col;
-    auto moves = _gen_ordered_moves(engine, color, 0);
+    U64 key = engine.hash_key;
+    TTEntry tte;
+    Move hash_move = tt->probe(key, tte) ? tte.move() : NO_MOVE;
+    if (!prev_pv.empty())
+      hash_move = prev_pv[0];
+    pv_length[0] = 0;
+
+    auto ci = engine.compute_check_info();
+    MovePicker picker(*this, engine, ci, hash_move, 0, false);
+    int original_alpha = alpha;
     int best_score = -999999;
-    MoveFull best_move = {-1, -1, -1, -1, ""};
+    Move best_move = NO_MOVE;
     bool first_move = true;
 
-    for (auto &move : moves) {
-      if (get_time() - start_time > time_limit)
+    for (Move move; (move = picker.next()) != NO_MOVE;) {
+      if (_check_abort())
         break;
-
-      auto st = engine.save_state();
-      int tc = engine.turn_col;
-
-      engine.make_move_fast(get<0>(move), get<1>(move), get<2>(move),
-                            get<3>(move), get<4>(move));
-
-      // Validate move
-      if (engine.is_attacked(bb_ctzll(engine.pieces[color][K]),
-                             engine.enemy_col(color))) {
-        engine.restore_state(st, tc);
+      if (!root_tb_moves.empty() &&
+          find(root_tb_moves.begin(), root_tb_moves.end(), move) ==
+              root_tb_moves.end())
         continue;
-      }
+
+      engine.make_move_fast(move);
+      tt->prefetch(engine.hash_key);
+      follow_pv = first_move && !prev_pv.empty() && move == prev_pv[0];
 
       int score;
       if (first_move) {
         // PVS: full window for first move
-        score = -_negamax(engine, depth - 1, -beta, -alpha);
+        score = -_negamax(engine, depth - 1, -beta, -alpha, 1);
         first_move = false;
       } else {
         // PVS: zero-window search
-        score = -_negamax(engine, depth - 1, -alpha - 1, -alpha);
+        score = -_negamax(engine, depth - 1, -alpha - 1, -alpha, 1);
         if (score > alpha && score < beta) {
           // Re-search with full window
-          score = -_negamax(engine, depth - 1, -beta, -alpha);
+          score = -_negamax(engine, depth - 1, -beta, -alpha, 1);
         }
       }
-      engine.restore_state(st, tc);
+      engine.unmake_move(move);
+      follow_pv = false;
+      if (aborted)
+        break;
 
       if (score > best_score) {
         best_score = score;
         best_move = move;
       }
+      if (score > alpha)
+        _update_pv(0, move);
       alpha = max(alpha, score);
       if (alpha >= beta)
         break;
     }
+
+    if (best_move != NO_MOVE && !aborted) {
+      int flag = (best_score <= original_alpha)
+                     ? TT_ALPHA
+                     : ((best_score >= beta) ? TT_BETA : TT_EXACT);
+      tt->store(key, best_score, depth, flag,
+                flag == TT_ALPHA ? NO_MOVE : best_move);
+    }
     return {best_move, best_score};
   }
 
+  // `move` is the new best move at `ply`: the PV from here is `move`
+  // followed by the child's PV
+  void _update_pv(int ply, Move move) {
+    pv_table[ply][ply] = move;
+    int len = pv_length[ply + 1];
+    for (int i = ply + 1; i < len; i++)
+      pv_table[ply][i] = pv_table[ply + 1][i];
+    pv_length[ply] = max(len, ply + 1);
+  }
+
+  // Mate and tablebase scores are stored relative to the node rather than
+  // the root, so an entry stays valid when it is reached at a different ply
+  static int _score_to_tt(int score, int ply) {
+    return score >= TB_BOUND ? score + ply
+                             : (score <= -TB_BOUND ? score - ply : score);
+  }
+  static int _score_from_tt(int score, int ply) {
+    return score >= TB_BOUND ? score - ply
+                             : (score <= -TB_BOUND ? score + ply : score);
+  }
+
   // =============================================
   // 4. PVS — NEGAMAX with PVS
   // =============================================
-  int _negamax(ChessEngine &engine, int depth, int alpha, int beta) {
+  int _negamax(ChessEngine &engine, int depth, int alpha, int beta,
+               int ply) {
     nodes_searched++;
+    pv_length[ply] = ply;
 
-    if ((nodes_searched & 2047) == 0) {
-      if (get_time() - start_time > time_limit)
-        return 0;
+    if ((nodes_searched & 2047) == 0 && _check_abort())
+      return 0;
+
+    // Repetitions and fifty-move draws end the line before the TT is
+    // consulted, so cycles are cut instead of searched again
+    if (ply > 0 && engine.is_draw(ply))
+      return 0;
+
+    U64 key = engine.hash_key;
+    TTEntry tte;
+    bool tt_hit = tt->probe(key, tte);
+    Move hash_move = tt_hit ? tte.move() : NO_MOVE;
+    if (tt_hit && tte.depth() >= depth) {
+      int tt_score = _score_from_tt(tte.score(), ply);
+      if (tte.flag() == TT_EXACT)
+        return tt_score;
+      if (tte.flag() == TT_ALPHA && tt_score <= alpha)
+        return alpha;
+      if (tte.flag() == TT_BETA && tt_score >= beta)
+        return beta;
     }
 
-    auto key = _get_hash(engine);
-    if (transposition_table.find(key) != transposition_table.end()) {
-      auto &tt = transposition_table[key];
-      if (tt.full_key == key && tt.depth >= depth) {
-        if (tt.flag == TT_EXACT)
-          return tt.score;
-        if (tt.flag == TT_ALPHA && tt.score <= alpha)
-          return alpha;
-        if (tt.flag == TT_BETA && tt.score >= beta)
-          return beta;
+    // Tablebase positions get their exact result. Only right after a
+    // capture or pawn move: the WDL tables ignore the fifty-move counter.
+    if (ply > 0 && engine.halfmove_clock == 0 && !engine.castling &&
+        count_bits(engine.occupied) <= tb->max_pieces()) {
+      int result;
+      int wdl = tb->probe_wdl(engine, result);
+      if (result != TB_FAIL) {
+        tb_hits++;
+        int score = wdl == TB_WIN    ? TB_WIN_SCORE - ply
+                    : wdl == TB_LOSS ? -TB_WIN_SCORE + ply
+                                     : 2 * wdl;
+        tt->store(key, _score_to_tt(score, ply), min(depth + 6, MAX_PLY - 1),
+                  TT_EXACT, NO_MOVE);
+        return score;
       }
     }
 
-    int color = engine.turn_col;
-    bool in_check = engine.in_check_col(color);
+    auto ci = engine.compute_check_info();
+    bool in_check = ci.checkers != 0;
+
+    // Horizon: the quiescence result is stored at depth 0 with the static
+    // eval, so a transposition reaching this node again reuses either
+    if (depth == 0 || ply >= MAX_PLY - 1) {
+      int eval = tt_hit && tte.eval() != TT_NO_EVAL ? tte.eval()
+                                                    : _static_eval(engine);
+      int score = _quiescence(engine, alpha, beta, ply, eval);
+      if (!aborted)
+        tt->store(key, _score_to_tt(score, ply), 0,
+                  score <= alpha ? TT_ALPHA
+                                 : (score >= beta ? TT_BETA : TT_EXACT),
+                  NO_MOVE, eval);
+      return score;
+    }
 
-    if (depth == 0)
-      return _quiescence(engine, alpha, beta);
+    // Still on the previous iteration's PV: its move goes first
+    bool on_pv = follow_pv && ply < (int)prev_pv.size();
+    if (on_pv)
+      hash_move = prev_pv[ply];
 
     // Null move pruning
     if (!in_check && depth >= 3) {
-      int total_mat = 0;
-      for (int i = 0; i < 5; i++) {
-        total_mat += count_bits(engine.pieces[WHITE][i]) * PIECE_VALUE[i];
-        total_mat += count_bits(engine.pieces[BLACK][i]) * PIECE_VALUE[i];
-      }
+      int total_mat =
+          engine.psqt.material[WHITE] + engine.psqt.material[BLACK];
       if (total_mat > 1500) {
         int R = 2;
-        auto nm_st = engine.save_state();
-        int nm_tc = engine.turn_col;
-        engine.turn_col = engine.enemy_col(color);
-        int null_score = -_negamax(engine, depth - 1 - R, -beta, -beta + 1);
-        engine.restore_state(nm_st, nm_tc);
+        bool saved_follow = follow_pv;
+        follow_pv = false;
+        engine.make_null_move();
+        int null_score =
+            -_negamax(engine, depth - 1 - R, -beta, -beta + 1, ply + 1);
+        engine.unmake_null_move();
+        follow_pv = saved_follow;
+        if (aborted)
+          return 0;
         if (null_score >= beta)
           return beta;
       }
     }
 
-    int ply = max(0, max_depth - depth);
-    auto moves = _gen_ordered_moves(engine, color, ply);
+    MovePicker picker(*this, engine, ci, hash_move, ply, false);
 
     int original_alpha = alpha;
     int best_score = -999999;
+    Move best_move = NO_MOVE;
     int move_count = 0;
     bool has_legal = false;
     bool pv_search_done = false;
 
-    for (auto &move : moves) {
-      auto st = engine.save_state();
-      int tc = engine.turn_col;
-
-      int tr = get<2>(move);
-      int tc_sq = get<3>(move);
-      string promo = get<4>(move);
-      bool is_capture = (engine.occupied & (1ULL << (tr * 8 + tc_sq))) != 0;
+    for (Move move; (move = picker.next()) != NO_MOVE;) {
+      bool is_capture = move_is_capture(move);
+      bool is_promo = move_is_promo(move);
 
-      engine.make_move_fast(get<0>(move), get<1>(move), tr, tc_sq, promo);
-      if (engine.is_attacked(bb_ctzll(engine.pieces[color][K]),
-                             engine.enemy_col(color))) {
-        engine.restore_state(st, tc);
-        continue;
-      }
+      engine.make_move_fast(move);
+      tt->prefetch(engine.hash_key);
+      follow_pv = on_pv && move_count == 0 && move == prev_pv[ply];
       has_legal = true;
 
       // LMR
       int reduction = 0;
       if (!in_check && !is_capture && depth >= 3 && move_count >= 3 &&
-          promo.empty()) {
+          !is_promo) {
         int d_idx = min(depth, 8);
         int m_idx = min(move_count, 32);
         reduction = max(0, min(LMR_table[d_idx][m_idx], depth - 2));
@@ -356,27 +796,35 @@ public:
       int score;
       if (!pv_search_done) {
         // First legal move: full window
-        score = -_negamax(engine, depth - 1 - reduction, -beta, -alpha);
+        score = -_negamax(engine, depth - 1 - reduction, -beta, -alpha,
+                          ply + 1);
         if (reduction > 0 && score > alpha) {
-          score = -_negamax(engine, depth - 1, -beta, -alpha);
+          score = -_negamax(engine, depth - 1, -beta, -alpha, ply + 1);
         }
         pv_search_done = true;
       } else {
         // PVS: zero-window
-        score = -_negamax(engine, depth - 1 - reduction, -alpha - 1, -alpha);
+        score = -_negamax(engine, depth - 1 - reduction, -alpha - 1, -alpha,
+                          ply + 1);
         if (score > alpha && score < beta) {
           // Re-search with full window
-          score = -_negamax(engine, depth - 1, -beta, -alpha);
+          score = -_negamax(engine, depth - 1, -beta, -alpha, ply + 1);
         }
       }
-      engine.restore_state(st, tc);
+      engine.unmake_move(move);
+      follow_pv = false;
+      if (aborted)
+        return 0;
       move_count++;
 
-      if (score > best_score)
+      if (score > best_score) {
         best_score = score;
+        best_move = move;
+      }
       if (score > alpha) {
         alpha = score;
-        if (!is_capture && promo.empty()) {
+        _update_pv(ply, move);
+        if (!is_capture && !is_promo) {
           auto &km = killer_moves[ply];
           if (km.first != move) {
             km.second = km.first;
@@ -386,24 +834,22 @@ public:
       }
 
       if (alpha >= beta) {
-        if (!is_capture && promo.empty()) {
-          history[(U64)get<0>(move) ^ ((U64)get<1>(move) << 8) ^
-                  ((U64)tr << 16) ^ ((U64)tc_sq << 24)] += depth * depth;
+        if (!is_capture && !is_promo) {
+          history[move_from(move)][move_to(move)] += depth * depth;
         }
         break;
       }
     }
 
     if (!has_legal) {
-      return in_check ? -(20000 - depth) : 0;
+      return in_check ? -(MATE_SCORE - ply) : 0;
     }
 
-    if (transposition_table.size() > 500000)
-      transposition_table.clear();
     int flag = (best_score <= original_alpha)
                    ? TT_ALPHA
                    : ((best_score >= beta) ? TT_BETA : TT_EXACT);
-    transposition_table[key] = {key, best_score, depth, flag};
+    tt->store(key, _score_to_tt(best_score, ply), depth, flag,
+              flag == TT_ALPHA ? NO_MOVE : best_move);
 
     return best_score;
   }
@@ -411,46 +857,39 @@ public:
   // =============================================
   // QUIESCENCE with SEE pruning
   // =============================================
-  int _quiescence(ChessEngine &engine, int alpha, int beta) {
+  // `stand_pat` is the static eval when the caller already has it
+  int _quiescence(ChessEngine &engine, int alpha, int beta, int ply,
+                  int stand_pat = TT_NO_EVAL) {
     nodes_searched++;
+    pv_length[ply] = ply;
 
-    if ((nodes_searched & 2047) == 0) {
-      if (get_time() - start_time > time_limit)
-        return 0;
-    }
+    if ((nodes_searched & 2047) == 0 && _check_abort())
+      return 0;
 
-    int stand_pat = _evaluate(engine);
+    if (stand_pat == TT_NO_EVAL)
+      stand_pat = _static_eval(engine);
+    if (ply >= MAX_PLY - 1)
+      return stand_pat;
     if (stand_pat >= beta)
       return beta;
     if (alpha < stand_pat)
       alpha = stand_pat;
 
     int color = engine.turn_col;
-    auto moves = _gen_ordered_moves(engine, color, 0);
-
-    for (auto &move : moves) {
-      int tr = get<2>(move);
-      int tc = get<3>(move);
-      int tsq = tr * 8 + tc;
-      if (!(engine.colors[engine.enemy_col(color)] & (1ULL << tsq)))
-        continue; // Only captures
+    auto ci = engine.compute_check_info();
+    MovePicker picker(*this, engine, ci, NO_MOVE, 0, true);
 
+    for (Move move; (move = picker.next()) != NO_MOVE;) {
       // SEE pruning: skip losing captures
-      if (_see(engine, get<0>(move), get<1>(move), tr, tc, color) < 0)
+      if (_see(engine, move, color) < 0)
         continue;
 
-      auto st = engine.save_state();
-      int tc_save = engine.turn_col;
+      engine.make_move_fast(move);
 
-      engine.make_move_fast(get<0>(move), get<1>(move), tr, tc, get<4>(move));
-      if (engine.is_attacked(bb_ctzll(engine.pieces[color][K]),
-                             engine.enemy_col(color))) {
-        engine.restore_state(st, tc_save);
-        continue;
-      }
-
-      int score = -_quiescence(engine, -beta, -alpha);
-      engine.restore_state(st, tc_save);
+      int score = -_quiescence(engine, -beta, -alpha, ply + 1);
+      engine.unmake_move(move);
+      if (aborted)
+        return 0;
 
       if (score >= beta)
         return beta;
@@ -463,30 +902,18 @@ public:
   // =============================================
   // 4. SEE (Static Exchange Evaluation)
   // =============================================
-  int _see(ChessEngine &engine, int sr, int sc, int tr, int tc, int side) {
-    int from_sq = sr * 8 + sc;
-    int to_sq = tr * 8 + tc;
+  int _see(ChessEngine &engine, Move move, int side) {
+    int from_sq = move_from(move);
+    int to_sq = move_to(move);
 
     // Find the moving piece type
-    int attacker_piece = -1;
-    for (int i = 0; i < 6; i++) {
-      if (engine.pieces[side][i] & (1ULL << from_sq)) {
-        attacker_piece = i;
-        break;
-      }
-    }
+    int attacker_piece = engine.piece_at(side, from_sq);
     if (attacker_piece < 0)
       return 0;
 
     // Find the victim piece type
     int enemy = engine.enemy_col(side);
-    int victim_piece = -1;
-    for (int i = 0; i < 6; i++) {
-      if (engine.pieces[enemy][i] & (1ULL << to_sq)) {
-        victim_piece = i;
-        break;
-      }
-    }
+    int victim_piece = engine.piece_at(enemy, to_sq);
     if (victim_piece < 0)
       return 0; // no capture
 
@@ -512,60 +939,32 @@ public:
 
   int get_piece_value(int c, int sq) { return 0; }
 
-  // =============================================
-  // 2+3. EVALUATION: Material + PST + Pawn Structure + King Safety
-  // =============================================
-  int _evaluate(ChessEngine &engine) {
-    int sw = 0, sb = 0;
-    int mat_w = 0, mat_b = 0;
-    for (int i = 0; i < 5; i++) {
-      mat_w += count_bits(engine.pieces[WHITE][i]) * PIECE_VALUE[i];
-      mat_b += count_bits(engine.pieces[BLACK][i]) * PIECE_VALUE[i];
+  // _evaluate through the eval cache
+  int _static_eval(ChessEngine &engine) {
+    int eval;
+    eval_probes++;
+    if (eval_hash.probe(engine.hash_key, eval)) {
+      eval_hits++;
+      return eval;
     }
-    bool endgame = (mat_w + mat_b) < 1500;
-
-    sw += mat_w;
-    sb += mat_b;
-
-    // --- Piece-Square Tables ---
-    auto eval_pst = [&](int color, int p_type, const int table[64]) {
-      int score = 0;
-      U64 bb = engine.pieces[color][p_type];
-      while (bb) {
-        int sq = bb_ctzll(bb);
-        score += table[color == WHITE ? sq : (sq ^ 56)];
-        bb &= bb - 1;
-      }
-      return score;
-    };
-
-    sw += eval_pst(WHITE, P, PST_P);
-    sw += eval_pst(WHITE, N, PST_N);
-    sw += eval_pst(WHITE, B, PST_B);
-    sw += eval_pst(WHITE, R, PST_R);
-    sw += eval_pst(WHITE, Q, PST_Q);
-    sw += eval_pst(WHITE, K, endgame ? PST_K_end : PST_K_mid);
-
-    sb += eval_pst(BLACK, P, PST_P);
-    sb += eval_pst(BLACK, N, PST_N);
-    sb += eval_pst(BLACK, B, PST_B);
-    sb += eval_pst(BLACK, R, PST_R);
-    sb += eval_pst(BLACK, Q, PST_Q);
-    sb += eval_pst(BLACK, K, endgame ? PST_K_end : PST_K_mid);
+    eval = _evaluate(engine);
+    eval_hash.store(engine.hash_key, eval);
+    return eval;
+  }
 
-    // --- Bishop pair bonus ---
-    if (count_bits(engine.pieces[WHITE][B]) >= 2)
-      sw += 30;
-    if (count_bits(engine.pieces[BLACK][B]) >= 2)
-      sb += 30;
+  // Doubled / isolated / passed pawn terms for both colors, computed once
+  // per pawn configuration. Passed pawns and pawn attacks are kept with
+  // the score for other evaluation terms.
+  PawnEntry &_probe_pawns(const ChessEngine &engine) {
+    PawnEntry &e = pawn_hash.slot(engine.pawn_key);
+    if (e.key == engine.pawn_key)
+      return e;
+    e.key = engine.pawn_key;
 
-    // =============================================
-    // 2. PAWN STRUCTURE EVALUATION
-    // =============================================
-    auto eval_pawns = [&](int color) {
+    for (int color = 0; color < 2; color++) {
       int score = 0;
       U64 my_pawns = engine.pieces[color][P];
-      U64 opp_pawns = engine.pieces[color == WHITE ? BLACK : WHITE][P];
+      U64 opp_pawns = engine.pieces[color ^ 1][P];
 
       for (int file = 0; file < 8; file++) {
         U64 file_pawns = my_pawns & FILE_MASKS[file];
@@ -582,50 +981,52 @@ public:
         }
       }
 
-      // Passed pawns bonus
-      U64 pawns_copy = my_pawns;
-      while (pawns_copy) {
-        int sq = bb_ctzll(pawns_copy);
-        int rank = sq / 8;
-        int file = sq % 8;
-
-        // Generate forward mask: all squares ahead on same + adjacent files
-        U64 forward_mask = 0;
-        if (color == WHITE) {
-          for (int r = rank - 1; r >= 0; r--) {
-            forward_mask |= (1ULL << (r * 8 + file));
-            if (file > 0)
-              forward_mask |= (1ULL << (r * 8 + file - 1));
-            if (file < 7)
-              forward_mask |= (1ULL << (r * 8 + file + 1));
-          }
-          if (!(opp_pawns & forward_mask)) {
-            score +=
-                PASSED_PAWN_BONUS[7 -
-                                  rank]; // closer to promotion = bigger bonus
-          }
-        } else {
-          for (int r = rank + 1; r < 8; r++) {
-            forward_mask |= (1ULL << (r * 8 + file));
-            if (file > 0)
-              forward_mask |= (1ULL << (r * 8 + file - 1));
-            if (file < 7)
-              forward_mask |= (1ULL << (r * 8 + file + 1));
-          }
-          if (!(opp_pawns & forward_mask)) {
-            score +=
-                PASSED_PAWN_BONUS[rank]; // closer to promotion = bigger bonus
-          }
+      // Passed pawns bonus: closer to promotion = bigger bonus
+      e.passed[color] = 0;
+      for (U64 bb = my_pawns; bb; bb &= bb - 1) {
+        int sq = bb_ctzll(bb);
+        if (!(opp_pawns & passed_pawn_masks[color][sq])) {
+          e.passed[color] |= 1ULL << sq;
+          score += PASSED_PAWN_BONUS[color == WHITE ? 7 - sq / 8 : sq / 8];
         }
-
-        pawns_copy &= pawns_copy - 1;
       }
+      e.score[color] = score;
+    }
 
-      return score;
-    };
+    // White pawns capture towards lower square indices
+    U64 wp = engine.pieces[WHITE][P], bp = engine.pieces[BLACK][P];
+    e.attacks[WHITE] = ((wp >> 9) & ~FILE_H) | ((wp >> 7) & ~FILE_A);
+    e.attacks[BLACK] = ((bp << 7) & ~FILE_H) | ((bp << 9) & ~FILE_A);
+    return e;
+  }
+
+  // =============================================
+  // 2+3. EVALUATION: Material + PST + Pawn Structure + King Safety
+  // =============================================
+  int _evaluate(ChessEngine &engine) {
+    if (engine.nnue)
+      return engine.nnue->evaluate(engine.nnue_stack.back(), engine.turn_col);
 
-    sw += eval_pawns(WHITE);
-    sb += eval_pawns(BLACK);
+    // Material and piece-square tables come from the incremental sums
+    int mat_w = engine.psqt.material[WHITE];
+    int mat_b = engine.psqt.material[BLACK];
+    bool endgame = (mat_w + mat_b) < 1500;
+    const int *pst = endgame ? engine.psqt.eg : engine.psqt.mg;
+    int sw = mat_w + pst[WHITE];
+    int sb = mat_b + pst[BLACK];
+
+    // --- Bishop pair bonus ---
+    if (count_bits(engine.pieces[WHITE][B]) >= 2)
+      sw += 30;
+    if (count_bits(engine.pieces[BLACK][B]) >= 2)
+      sb += 30;
+
+    // =============================================
+    // 2. PAWN STRUCTURE EVALUATION (cached by pawn key)
+    // =============================================
+    const PawnEntry &pawns = _probe_pawns(engine);
+    sw += pawns.score[WHITE];
+    sb += pawns.score[BLACK];
 
     // =============================================
     // 3. KING SAFETY EVALUATION (middlegame only)
@@ -643,29 +1044,7 @@ public:
         int enemy = engine.enemy_col(color);
 
         // Pawn shield: count friendly pawns in front of king (1-2 ranks ahead)
-        U64 shield_mask = 0;
-        if (color == WHITE) {
-          int shield_rank = king_sq / 8 - 1;
-          if (shield_rank >= 0) {
-            for (int f = max(0, king_file - 1); f <= min(7, king_file + 1);
-                 f++) {
-              shield_mask |= (1ULL << (shield_rank * 8 + f));
-              if (shield_rank - 1 >= 0)
-                shield_mask |= (1ULL << ((shield_rank - 1) * 8 + f));
-            }
-          }
-        } else {
-          int shield_rank = king_sq / 8 + 1;
-          if (shield_rank < 8) {
-            for (int f = max(0, king_file - 1); f <= min(7, king_file + 1);
-                 f++) {
-              shield_mask |= (1ULL << (shield_rank * 8 + f));
-              if (shield_rank + 1 < 8)
-                shield_mask |= (1ULL << ((shield_rank + 1) * 8 + f));
-            }
-          }
-        }
-        score += count_bits(my_pawns & shield_mask) * 10;
+        score += count_bits(my_pawns & pawn_shield_masks[color][king_sq]) * 10;
 
         // Open files near king penalty
         for (int f = max(0, king_file - 1); f <= min(7, king_file + 1); f++) {
@@ -719,76 +1098,137 @@ public:
   }
 
   // =============================================
-  // MOVE ORDERING
+  // MOVE ORDERING: staged, lazy move picker
   // =============================================
-  vector<MoveFull> _gen_ordered_moves(ChessEngine &engine, int color, int ply) {
-    vector<tuple<MoveFull, int>> list_caps, list_kills, list_quiets;
-    ply = max(0, min(ply, (int)killer_moves.size() - 1));
-    auto &km = killer_moves[ply];
-
-    auto moves = engine.get_pseudo_moves(color);
-    int enemy = engine.enemy_col(color);
-
-    for (auto &m : moves) {
-      int sr = get<0>(m), sc = get<1>(m), tr = get<2>(m), tc = get<3>(m);
-      U64 tsq_bb = 1ULL << (tr * 8 + tc);
-
-      bool is_cap = false;
-      int victim_val = 0;
-      for (int i = 0; i < 6; i++) {
-        if (engine.pieces[enemy][i] & tsq_bb) {
-          is_cap = true;
-          victim_val = MVV_LVA[i];
-          break;
-        }
+  // Hash move first, then captures picked best-first by SEE, then the two
+  // killers, then quiets by history. Each stage is only generated when the
+  // previous one is exhausted, so cut nodes usually never generate quiets.
+  // In captures-only mode (quiescence) the picker stops after the captures.
+  // Every move returned is fully legal.
+  enum PickStage {
+    STAGE_HASH,
+    STAGE_GEN_CAPTURES,
+    STAGE_CAPTURES,
+    STAGE_KILLER_1,
+    STAGE_KILLER_2,
+    STAGE_GEN_QUIETS,
+    STAGE_QUIETS,
+    STAGE_DONE
+  };
+
+  struct MovePicker {
+    AlphaBetaEngine &ai;
+    ChessEngine &engine;
+    const ChessEngine::CheckInfo &ci;
+    Move hash_move;
+    Move killer_1 = NO_MOVE;
+    Move killer_2 = NO_MOVE;
+    bool captures_only;
+    int stage = STAGE_HASH;
+    int cur = 0;
+    MoveList list;
+
+    MovePicker(AlphaBetaEngine &ai, ChessEngine &engine,
+               const ChessEngine::CheckInfo &ci, Move hash_move, int ply,
+               bool captures_only)
+        : ai(ai), engine(engine), ci(ci), hash_move(hash_move),
+          captures_only(captures_only) {
+      if (!captures_only) {
+        ply = max(0, min(ply, (int)ai.killer_moves.size() - 1));
+        killer_1 = ai.killer_moves[ply].first;
+        killer_2 = ai.killer_moves[ply].second;
       }
+    }
 
-      int moved_kind = P;
-      for (int i = 0; i < 6; i++) {
-        if (engine.pieces[color][i] & (1ULL << (sr * 8 + sc))) {
-          moved_kind = i;
-          break;
-        }
+    // Selection sort step: swap the best remaining move into `cur`
+    Move pick_best() {
+      int best = cur;
+      for (int i = cur + 1; i < list.count; i++) {
+        if (list.scores[i] > list.scores[best])
+          best = i;
       }
+      swap(list.moves[cur], list.moves[best]);
+      swap(list.scores[cur], list.scores[best]);
+      return list.moves[cur++];
+    }
 
-      if (is_cap) {
-        // Use SEE for better capture ordering
-        int see_val = _see(engine, sr, sc, tr, tc, color);
-        int score = see_val + 10000; // ensure captures are sorted above quiets
-        if (!get<4>(m).empty())
-          score += PIECE_VALUE[Q];
-        list_caps.push_back({m, score});
-      } else {
-        if (!get<4>(m).empty()) {
-          list_quiets.push_back({m, PIECE_VALUE[Q]});
-          continue;
+    bool is_valid(Move m) const {
+      return engine.is_pseudo_legal(m) && engine.is_legal(m, ci);
+    }
+
+    bool is_valid_killer(Move m) const {
+      return m != NO_MOVE && m != hash_move && is_valid(m);
+    }
+
+    Move next() {
+      switch (stage) {
+      case STAGE_HASH:
+        stage++;
+        if (hash_move != NO_MOVE && is_valid(hash_move))
+          return hash_move;
+        [[fallthrough]];
+
+      case STAGE_GEN_CAPTURES:
+        engine.generate_legal<GEN_CAPTURES>(list, ci);
+        for (int i = 0; i < list.count; i++) {
+          Move m = list.moves[i];
+          list.scores[i] = ai._see(engine, m, engine.turn_col);
+          if (move_is_promo(m))
+            list.scores[i] += PIECE_VALUE[Q];
+        }
+        stage++;
+        [[fallthrough]];
+
+      case STAGE_CAPTURES:
+        while (cur < list.count) {
+          Move m = pick_best();
+          if (m != hash_move)
+            return m;
         }
-        if (m == km.first || m == km.second) {
-          list_kills.push_back({m, 9000});
-        } else {
-          U64 hist_key =
-              (U64)sr ^ ((U64)sc << 8) ^ ((U64)tr << 16) ^ ((U64)tc << 24);
-          list_quiets.push_back({m, history[hist_key]});
+        if (captures_only) {
+          stage = STAGE_DONE;
+          return NO_MOVE;
         }
+        stage++;
+        [[fallthrough]];
+
+      case STAGE_KILLER_1:
+        stage++;
+        if (is_valid_killer(killer_1))
+          return killer_1;
+        [[fallthrough]];
+
+      case STAGE_KILLER_2:
+        stage++;
+        if (killer_2 != killer_1 && is_valid_killer(killer_2))
+          return killer_2;
+        [[fallthrough]];
+
+      case STAGE_GEN_QUIETS: {
+        int first = list.count;
+        engine.generate_legal<GEN_QUIETS>(list, ci);
+        for (int i = first; i < list.count; i++) {
+          Move m = list.moves[i];
+          list.scores[i] = ai.history[move_from(m)][move_to(m)];
+        }
+        stage++;
       }
-    }
+        [[fallthrough]];
 
-    auto sf = [](const tuple<MoveFull, int> &a, const tuple<MoveFull, int> &b) {
-      return get<1>(a) > get<1>(b);
-    };
-    sort(list_caps.begin(), list_caps.end(), sf);
-    sort(list_kills.begin(), list_kills.end(), sf);
-    sort(list_quiets.begin(), list_quiets.end(), sf);
+      case STAGE_QUIETS:
+        while (cur < list.count) {
+          Move m = pick_best();
+          if (m != hash_move && m != killer_1 && m != killer_2)
+            return m;
+        }
+        stage = STAGE_DONE;
+        [[fallthrough]];
 
-    vector<MoveFull> res;
-    for (auto &x : list_caps)
-      res.push_back(get<0>(x));
-    for (auto &x : list_kills)
-      res.push_back(get<0>(x));
-    for (auto &x : list_quiets)
-      res.push_back(get<0>(x));
-    return res;
-  }
+      default:
+        return NO_MOVE;
+      }
+    }
+  };
 };
 
 #endif
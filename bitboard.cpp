@@ -4,6 +4,8 @@ U64 pawn_attacks[2][64];
 U64 knight_attacks[64];
 U64 king_attacks[64];
 U64 ray_attacks[64][8];
+U64 between_bb[64][64];
+U64 line_bb[64][64];
 
 const U64 FILE_A = 0x0101010101010101ULL;
 const U64 FILE_H = 0x8080808080808080ULL;
@@ -82,10 +84,41 @@ void init_sliders() {
   }
 }
 
+void init_lines() {
+  for (int a = 0; a < 64; a++) {
+    for (int b = 0; b < 64; b++) {
+      between_bb[a][b] = line_bb[a][b] = 0;
+      if (a == b)
+        continue;
+      U64 a_bb = 1ULL << a, b_bb = 1ULL << b;
+      if (get_rook_attacks_classical(a, 0) & b_bb) {
+        line_bb[a][b] = (get_rook_attacks_classical(a, 0) &
+                         get_rook_attacks_classical(b, 0)) |
+                        a_bb | b_bb;
+        between_bb[a][b] = get_rook_attacks_classical(a, b_bb) &
+                           get_rook_attacks_classical(b, a_bb);
+      } else if (get_bishop_attacks_classical(a, 0) & b_bb) {
+        line_bb[a][b] = (get_bishop_attacks_classical(a, 0) &
+                         get_bishop_attacks_classical(b, 0)) |
+                        a_bb | b_bb;
+        between_bb[a][b] = get_bishop_attacks_classical(a, b_bb) &
+                           get_bishop_attacks_classical(b, a_bb);
+      }
+    }
+  }
+}
+
 void init_all_bitboards() {
+  static bool initialized = false;
+  if (initialized)
+    return;
   init_leapers();
   init_sliders();
+  init_lines();
+  init_magics();
   init_zobrist();
+  init_pawn_masks();
+  initialized = true;
 }
 
 // --- Zobrist Hashing ---
@@ -137,6 +170,40 @@ const U64 ADJ_FILE_MASKS[8] = {
     FILE_MASKS[6]                  // H: only G
 };
 
+U64 forward_file_masks[2][64];
+U64 passed_pawn_masks[2][64];
+U64 pawn_shield_masks[2][64];
+
+void init_pawn_masks() {
+  for (int sq = 0; sq < 64; sq++) {
+    int r = sq / 8;
+    int c = sq % 8;
+    // White moves towards rank index 0, black towards 7
+    U64 ahead[2] = {0, 0};
+    for (int rr = 0; rr < r; rr++)
+      ahead[0] |= 0xFFULL << (rr * 8);
+    for (int rr = r + 1; rr < 8; rr++)
+      ahead[1] |= 0xFFULL << (rr * 8);
+
+    for (int color = 0; color < 2; color++) {
+      forward_file_masks[color][sq] = ahead[color] & FILE_MASKS[c];
+      passed_pawn_masks[color][sq] =
+          ahead[color] & (FILE_MASKS[c] | ADJ_FILE_MASKS[c]);
+
+      // The two ranks in front of the king
+      int step = color == 0 ? -1 : 1;
+      U64 shield = 0;
+      for (int i = 1; i <= 2; i++) {
+        int rr = r + step * i;
+        if (rr >= 0 && rr < 8)
+          shield |= 0xFFULL << (rr * 8);
+      }
+      pawn_shield_masks[color][sq] =
+          shield & (FILE_MASKS[c] | ADJ_FILE_MASKS[c]);
+    }
+  }
+}
+
 U64 get_ray_attacks(int sq, U64 blockers, int dir) {
   U64 attacks = ray_attacks[sq][dir];
   U64 blocker_ray = attacks & blockers;
@@ -154,20 +221,178 @@ U64 get_ray_attacks(int sq, U64 blockers, int dir) {
   return attacks;
 }
 
-U64 get_bishop_attacks(int sq, U64 blockers) {
+U64 get_bishop_attacks_classical(int sq, U64 blockers) {
   return get_ray_attacks(sq, blockers, DIR_NW) |
          get_ray_attacks(sq, blockers, DIR_NE) |
          get_ray_attacks(sq, blockers, DIR_SW) |
          get_ray_attacks(sq, blockers, DIR_SE);
 }
 
-U64 get_rook_attacks(int sq, U64 blockers) {
+U64 get_rook_attacks_classical(int sq, U64 blockers) {
   return get_ray_attacks(sq, blockers, DIR_N) |
          get_ray_attacks(sq, blockers, DIR_S) |
          get_ray_attacks(sq, blockers, DIR_E) |
          get_ray_attacks(sq, blockers, DIR_W);
 }
 
-U64 get_queen_attacks(int sq, U64 blockers) {
-  return get_bishop_attacks(sq, blockers) | get_rook_attacks(sq, blockers);
+// --- Magic bitboards ---
+SliderMagic bishop_magics[64];
+SliderMagic rook_magics[64];
+#ifdef SLIDER_PEXT
+bool use_pext = false;
+#endif
+
+// 102400 rook entries + 5248 bishop entries
+static U64 slider_table[107648];
+
+#ifdef SLIDER_PEXT
+#if defined(_MSC_VER) && defined(_M_X64)
+static void cpuid(int leaf, unsigned regs[4]) {
+  int r[4];
+  __cpuidex(r, leaf, 0);
+  for (int i = 0; i < 4; i++)
+    regs[i] = (unsigned)r[i];
+}
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <cpuid.h>
+static void cpuid(int leaf, unsigned regs[4]) {
+  __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+}
+#endif
+
+// BMI2 present and not one of the AMD parts (before Zen 3) where PEXT is
+// microcoded and slower than a magic multiply.
+static bool cpu_has_fast_pext() {
+#if (defined(_MSC_VER) && defined(_M_X64)) ||                                 \
+    ((defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__))
+  unsigned regs[4];
+  cpuid(0, regs);
+  if (regs[0] < 7)
+    return false;
+  bool amd = regs[1] == 0x68747541; // "Auth"enticAMD
+  cpuid(7, regs);
+  if (!(regs[1] & (1u << 8)))
+    return false;
+  if (amd) {
+    cpuid(1, regs);
+    int family = (regs[0] >> 8) & 0xF;
+    if (family == 0xF)
+      family += (regs[0] >> 20) & 0xFF;
+    if (family < 0x19)
+      return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+#endif
+
+static const U64 ROW_0 = 0x00000000000000FFULL; // rank 8
+static const U64 ROW_7 = 0xFF00000000000000ULL; // rank 1
+
+static U64 bishop_mask(int sq) {
+  return get_bishop_attacks_classical(sq, 0) &
+         ~(ROW_0 | ROW_7 | FILE_A | FILE_H);
+}
+
+static U64 rook_mask(int sq) {
+  return (ray_attacks[sq][DIR_N] & ~ROW_0) |
+         (ray_attacks[sq][DIR_S] & ~ROW_7) |
+         (ray_attacks[sq][DIR_E] & ~FILE_H) |
+         (ray_attacks[sq][DIR_W] & ~FILE_A);
+}
+
+// Magic multipliers, found offline with a sparse-random trial search
+static const U64 ROOK_MAGICS[64] = {
+    0x2080002080400010ULL, 0x00C0002001401000ULL, 0x2100110008402002ULL,
+    0x0880080081041000ULL, 0x0200020020041008ULL, 0x2300040008010012ULL,
+    0x0C00283004008201ULL, 0x0180010000407A80ULL, 0x0168800080400020ULL,
+    0x0010400040201000ULL, 0x1001002001001048ULL, 0x1001002408100100ULL,
+    0x0801000408010012ULL, 0x4001000209000400ULL, 0x08A20004C8020001ULL,
+    0x2002801145002280ULL, 0x0080860021004200ULL, 0x001000C009402002ULL,
+    0x00B0002004002800ULL, 0x100A808010020800ULL, 0x8101010008000410ULL,
+    0x0244008002000480ULL, 0x0000040010810208ULL, 0x2000020000448534ULL,
+    0x4104400480008033ULL, 0x0000810100204000ULL, 0x0440430900200010ULL,
+    0x4600240900100100ULL, 0x0060080080040080ULL, 0x0001000300080400ULL,
+    0x0004084400011002ULL, 0x0023040200008041ULL, 0x0580050043002080ULL,
+    0x0400804002802008ULL, 0x0001002001004010ULL, 0x1000200901001000ULL,
+    0x4410800801800C00ULL, 0xA012003806001004ULL, 0x0020100104008802ULL,
+    0x0004808402000041ULL, 0x0010400170898000ULL, 0x0080500020004004ULL,
+    0x1040408012020020ULL, 0x8010040008004040ULL, 0x2001080100110004ULL,
+    0x0000020004008080ULL, 0x0021010810040002ULL, 0x0800008C43020024ULL,
+    0x0000800021005100ULL, 0x0070201040008080ULL, 0x0000D04282006A00ULL,
+    0x0010014400080240ULL, 0x0001080110050100ULL, 0x0012000810240600ULL,
+    0x0402000801040200ULL, 0x028100108A004100ULL, 0x0050800300102045ULL,
+    0x8208210040120882ULL, 0x8010600101183441ULL, 0x020B000910006045ULL,
+    0x0241001002480005ULL, 0x0081000400880241ULL, 0x0000009008024124ULL,
+    0x0048122980410402ULL};
+
+static const U64 BISHOP_MAGICS[64] = {
+    0x0848020822040013ULL, 0x8010A40085821200ULL, 0x0008008430840822ULL,
+    0x0808048108040000ULL, 0x1304042100008104ULL, 0x5001012010204023ULL,
+    0x81048801B8200420ULL, 0x200A008084012000ULL, 0x0040102001042084ULL,
+    0x840A505042428020ULL, 0x0000700102202920ULL, 0x44101C0C10800002ULL,
+    0x0040040422000000ULL, 0x0180020802090202ULL, 0x4020020811041202ULL,
+    0x000104308C042000ULL, 0x4140661002424400ULL, 0x0028012008010460ULL,
+    0x0188062102002A00ULL, 0x0014004840102008ULL, 0x0105000290400002ULL,
+    0x8001022200410400ULL, 0x104A041918013446ULL, 0x008A000082008238ULL,
+    0x04A0060008100430ULL, 0x0008220008820801ULL, 0x2508041208005010ULL,
+    0x4008080200202020ULL, 0x2441001013004000ULL, 0x0030008060407000ULL,
+    0x4008108000420800ULL, 0x0012021050290100ULL, 0x0210080482200500ULL,
+    0xCC01112048100480ULL, 0x0020402806500440ULL, 0x00048E0080580080ULL,
+    0x0040102020020080ULL, 0x0028010440080807ULL, 0x4601041108008800ULL,
+    0x8040810E04104200ULL, 0x901210110400088AULL, 0xA003080212081050ULL,
+    0x00C1004048401004ULL, 0x900000A014400800ULL, 0x0008021040405401ULL,
+    0x4020008206002090ULL, 0x0004190424030100ULL, 0x0424008A02026250ULL,
+    0x8004088250900040ULL, 0x1C00430088A04200ULL, 0x0001020094040001ULL,
+    0x8040210020880061ULL, 0x2010040450442032ULL, 0x0800840850044001ULL,
+    0x0004040802140004ULL, 0x0004080A04222020ULL, 0x8088802110022000ULL,
+    0x1081A10416114400ULL, 0x0205010A24060820ULL, 0x0000000720411080ULL,
+    0x1008000208430400ULL, 0x580C026028810840ULL, 0x802020441020A110ULL,
+    0x12C0022401020018ULL};
+
+static void init_slider(SliderMagic *magics, const U64 *magic_numbers,
+                        bool bishop, U64 *&table) {
+  for (int sq = 0; sq < 64; sq++) {
+    SliderMagic &m = magics[sq];
+    m.mask = bishop ? bishop_mask(sq) : rook_mask(sq);
+    m.magic = magic_numbers[sq];
+    m.shift = 64 - count_bits(m.mask);
+    m.attacks = table;
+    table += 1ULL << count_bits(m.mask);
+
+    // Enumerate every subset of the mask (Carry-Rippler)
+    U64 sub = 0;
+    do {
+      m.attacks[slider_index(m, sub)] =
+          bishop ? get_bishop_attacks_classical(sq, sub)
+                 : get_rook_attacks_classical(sq, sub);
+      sub = (sub - m.mask) & m.mask;
+    } while (sub);
+  }
+}
+
+void init_magics() {
+#ifdef SLIDER_PEXT
+  use_pext = cpu_has_fast_pext();
+#endif
+  U64 *table = slider_table;
+  init_slider(rook_magics, ROOK_MAGICS, false, table);
+  init_slider(bishop_magics, BISHOP_MAGICS, true, table);
+}
+
+// Cross-check the lookup tables against the classical ray scan
+bool verify_slider_attacks(int samples) {
+  U64 seed = 0x2545F4914F6CDD1DULL;
+  for (int i = 0; i < samples; i++) {
+    int sq = (int)(xorshift64(seed) & 63);
+    U64 blockers = xorshift64(seed) & xorshift64(seed);
+    if (get_bishop_attacks(sq, blockers) !=
+            get_bishop_attacks_classical(sq, blockers) ||
+        get_rook_attacks(sq, blockers) !=
+            get_rook_attacks_classical(sq, blockers))
+      return false;
+  }
+  return true;
 }
@@ -62,13 +62,104 @@ extern const U64 FILE_GH;
 // rays to keep it simple but extremely fast.
 extern U64 ray_attacks[64][8]; // 8 directions: N, S, W, E, NW, NE, SW, SE
 
+// Squares strictly between two aligned squares, and the full line through
+// them (both are 0 when the squares do not share a rank, file or diagonal)
+extern U64 between_bb[64][64];
+extern U64 line_bb[64][64];
+
 void init_leapers();
 void init_sliders();
+void init_lines();
+void init_magics();
 void init_all_bitboards();
 
-U64 get_bishop_attacks(int sq, U64 blockers);
-U64 get_rook_attacks(int sq, U64 blockers);
-U64 get_queen_attacks(int sq, U64 blockers);
+// Classical ray-scan slider attacks. Kept as the reference implementation
+// the magic tables are built from and checked against.
+U64 get_bishop_attacks_classical(int sq, U64 blockers);
+U64 get_rook_attacks_classical(int sq, U64 blockers);
+bool verify_slider_attacks(int samples = 10000);
+
+// --- Magic bitboard slider lookup ---
+// Each square owns a slice of a shared attack table indexed either by a
+// magic multiply-shift of the relevant blockers, or by BMI2 PEXT when the
+// build targets BMI2 (-mbmi2 or -march=native; MSVC x64 always) and the CPU
+// has a fast implementation of it (chosen once at init). Other builds use
+// magics only: an out-of-line PEXT call is no faster than the multiply.
+struct SliderMagic {
+  U64 mask; // relevant occupancy, board edges excluded
+  U64 magic;
+  U64 *attacks;
+  int shift;
+};
+
+extern SliderMagic bishop_magics[64];
+extern SliderMagic rook_magics[64];
+
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(_M_X64))
+#define SLIDER_PEXT
+#include <immintrin.h>
+extern bool use_pext;
+static inline U64 bb_pext(U64 bb, U64 mask) { return _pext_u64(bb, mask); }
+#else
+static const bool use_pext = false;
+static inline U64 bb_pext(U64, U64) { return 0; } // never called
+#endif
+
+static inline unsigned slider_index(const SliderMagic &m, U64 blockers) {
+  if (use_pext)
+    return (unsigned)bb_pext(blockers, m.mask);
+  return (unsigned)(((blockers & m.mask) * m.magic) >> m.shift);
+}
+
+#ifdef CLASSICAL_SLIDERS
+static inline U64 get_bishop_attacks(int sq, U64 blockers) {
+  return get_bishop_attacks_classical(sq, blockers);
+}
+static inline U64 get_rook_attacks(int sq, U64 blockers) {
+  return get_rook_attacks_classical(sq, blockers);
+}
+#else
+static inline U64 get_bishop_attacks(int sq, U64 blockers) {
+  const SliderMagic &m = bishop_magics[sq];
+  return m.attacks[slider_index(m, blockers)];
+}
+static inline U64 get_rook_attacks(int sq, U64 blockers) {
+  const SliderMagic &m = rook_magics[sq];
+  return m.attacks[slider_index(m, blockers)];
+}
+#endif
+
+static inline U64 get_queen_attacks(int sq, U64 blockers) {
+  return get_bishop_attacks(sq, blockers) | get_rook_attacks(sq, blockers);
+}
+
+// --- Packed move encoding ---
+// bits 0-5: from square, bits 6-11: to square, bits 12-15: flags.
+// Flag bit 2 marks captures, bit 3 marks promotions; for promotions the low
+// two flag bits select the piece (N, B, R, Q).
+typedef uint16_t Move;
+static const Move NO_MOVE = 0;
+
+enum MoveFlag {
+  FLAG_QUIET = 0,
+  FLAG_DOUBLE_PUSH = 1,
+  FLAG_KING_CASTLE = 2,
+  FLAG_QUEEN_CASTLE = 3,
+  FLAG_CAPTURE = 4,
+  FLAG_EP_CAPTURE = 5,
+  FLAG_PROMO = 8,
+  FLAG_PROMO_CAPTURE = 12
+};
+
+static inline Move encode_move(int from, int to, int flags) {
+  return (Move)(from | (to << 6) | (flags << 12));
+}
+static inline int move_from(Move m) { return m & 63; }
+static inline int move_to(Move m) { return (m >> 6) & 63; }
+static inline int move_flags(Move m) { return m >> 12; }
+static inline bool move_is_capture(Move m) { return (m >> 12) & FLAG_CAPTURE; }
+static inline bool move_is_promo(Move m) { return (m >> 12) & FLAG_PROMO; }
+static inline int move_promo_piece(Move m) { return N + ((m >> 12) & 3); }
 
 enum Direction { DIR_N, DIR_S, DIR_E, DIR_W, DIR_NE, DIR_NW, DIR_SE, DIR_SW };
 
@@ -83,4 +174,10 @@ void init_zobrist();
 extern const U64 FILE_MASKS[8];
 extern const U64 ADJ_FILE_MASKS[8];
 
+// --- Pawn structure masks, by color and square ---
+extern U64 forward_file_masks[2][64]; // squares ahead on the same file
+extern U64 passed_pawn_masks[2][64];  // ahead on the same and adjacent files
+extern U64 pawn_shield_masks[2][64];  // 1-2 ranks ahead of a king, files +-1
+void init_pawn_masks();
+
 #endif
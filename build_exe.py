@@ -116,7 +116,7 @@ def compile_cpp_engine():
     else:
         # Linux
         run(
-            f'g++ -O3 -Wall -shared -std=c++17 -fPIC '
+            f'g++ -O3 -Wall -shared -std=c++17 -fPIC -pthread '
             f'{includes} '
             f'bitboard.cpp chess_engine.cpp '
             f'-o {output}'
@@ -1,31 +1,97 @@
 #include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <cstring>
 #include <iostream>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <tuple>
 #include <unordered_map>
 #include <vector>
 
 #include "bitboard.h"
+#include "nnue.h"
+#include "psqt.h"
 
 namespace py = pybind11;
 using namespace std;
 
+// Build with -DENGINE_DEBUG to cross-check incrementally updated state
+// against a full recomputation after every move.
+#ifdef ENGINE_DEBUG
+#include <cassert>
+#define DEBUG_ASSERT(x) assert(x)
+#else
+#define DEBUG_ASSERT(x)
+#endif
+
 typedef pair<int, int> Square;
-typedef tuple<int, int, int, int, string> MoveFull;
 
+// Move generation modes: everything, tactical moves only, or quiet moves only
+enum GenType { GEN_ALL, GEN_CAPTURES, GEN_QUIETS };
+
+// Fixed-capacity move list, lives on the stack so move generation and
+// ordering never touch the heap. 256 slots covers the legal maximum (218).
+static const int MAX_MOVES = 256;
+struct MoveList {
+  Move moves[MAX_MOVES];
+  int scores[MAX_MOVES];
+  int count = 0;
+
+  void add(Move m) { moves[count++] = m; }
+  const Move *begin() const { return moves; }
+  const Move *end() const { return moves + count; }
+};
+
+// Long algebraic (UCI) text for a move, e.g. "e2e4" or "e7e8q"
+static inline string move_to_uci(Move m) {
+  string s;
+  for (int sq : {move_from(m), move_to(m)}) {
+    s += char('a' + sq % 8);
+    s += char('8' - sq / 8);
+  }
+  if (move_is_promo(m))
+    s += "pnbrqk"[move_promo_piece(m)];
+  return s;
+}
+
+// Mailbox square contents: colour * 6 + piece type, or NO_PIECE
+static const int NO_PIECE = 12;
+static inline int make_piece(int color, int type) { return color * 6 + type; }
+static inline int piece_type(int pc) { return pc % 6; }
+static inline int piece_color(int pc) { return pc / 6; }
+
+// Castling rights kept after a move touches a square (king/rook origins)
+static const int CASTLING_MASK[64] = {
+    7,  15, 15, 15, 3,  15, 15, 11, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 13, 15, 15, 15, 12, 15, 15, 14};
+
+// Undo record pushed by make_move_fast: only the state a move cannot
+// reverse on its own
 struct UndoInfo {
-  U64 pieces[2][6];
-  U64 colors[2];
-  U64 occupied;
-  int turn_col;
+  U64 hash_key;
   int ep_square;
   int castling;
-  bool game_over;
-  string winner;
+  int halfmove_clock;
+  int plies_from_null;
+  uint8_t captured; // NO_PIECE if the move was not a capture
+};
+
+// Material (kings excluded) and piece-square sums per color. The
+// midgame and endgame sums differ only in the king table.
+struct Psqt {
+  int material[2] = {0, 0};
+  int mg[2] = {0, 0};
+  int eg[2] = {0, 0};
+
+  bool operator==(const Psqt &o) const {
+    return !memcmp(this, &o, sizeof(Psqt));
+  }
 };
 
 class ChessEngine {
@@ -33,16 +99,31 @@ public:
   U64 pieces[2][6];
   U64 colors[2];
   U64 occupied;
+  uint8_t board[64]; // piece on each square, kept in sync with the bitboards
 
   int turn_col; // WHITE(0), BLACK(1)
   int ep_square;
   int castling; // bit 0=WK, 1=WQ, 2=BK, 3=BQ
+  U64 hash_key; // Zobrist key, updated incrementally by make_move_fast
+  U64 pawn_key; // Zobrist key of the pawns alone (pawn hash table)
+  Psqt psqt;    // updated with every piece placed, removed or moved
+
+  // NNUE accumulators of the attached network: the position the network
+  // was attached at, then one per move made since (null moves need none)
+  const NnueNetwork *nnue = nullptr;
+  vector<NnueAccumulator> nnue_stack;
+  int halfmove_clock = 0; // plies since the last capture or pawn move
+  int plies_from_null = 0; // plies since the last null move (search only)
+  vector<UndoInfo> undo_stack;
+  int game_ply_base = 0; // plies played before the loaded position
 
   bool game_over = false;
   string winner = "";
+  string draw_reason = ""; // "stalemate", "repetition" or "fifty-move rule"
 
   ChessEngine() {
     init_all_bitboards();
+    undo_stack.reserve(1024);
     reset_board();
   }
 
@@ -72,42 +153,310 @@ public:
     pieces[WHITE][K] = 0x1000000000000000ULL;
     pieces[BLACK][K] = 0x0000000000000010ULL;
 
-    colors[WHITE] = pieces[WHITE][P] | pieces[WHITE][N] | pieces[WHITE][B] |
-                    pieces[WHITE][R] | pieces[WHITE][Q] | pieces[WHITE][K];
-    colors[BLACK] = pieces[BLACK][P] | pieces[BLACK][N] | pieces[BLACK][B] |
-                    pieces[BLACK][R] | pieces[BLACK][Q] | pieces[BLACK][K];
-    occupied = colors[WHITE] | colors[BLACK];
+    sync_board();
 
     turn_col = WHITE;
     ep_square = -1;
     castling = 15; // all rights 1111 (binary 15)
+    hash_key = compute_hash();
+    pawn_key = compute_pawn_key();
+    psqt = compute_psqt();
+    halfmove_clock = 0;
+    plies_from_null = 0;
+    game_ply_base = 0;
+    undo_stack.clear();
     game_over = false;
     winner = "";
+    draw_reason = "";
+    attach_nnue(nnue);
+  }
+
+  // Load a position from Forsyth-Edwards Notation. The move counters are
+  // optional; throws invalid_argument (ValueError in Python) on bad input
+  // and leaves the current position untouched.
+  void set_fen(const string &fen) {
+    ChessEngine saved = *this;
+    try {
+      load_fen(fen);
+    } catch (...) {
+      *this = saved;
+      throw;
+    }
+  }
+
+  void load_fen(const string &fen) {
+    istringstream ss(fen);
+    string placement, side, rights = "-", ep = "-";
+    int halfmove = 0, fullmove = 1;
+    if (!(ss >> placement >> side))
+      throw invalid_argument("FEN needs at least placement and side: " + fen);
+    ss >> rights >> ep >> halfmove >> fullmove;
+
+    for (int i = 0; i < 2; i++)
+      for (int j = 0; j < 6; j++)
+        pieces[i][j] = 0;
+
+    static const string PIECE_CHARS = "pnbrqk";
+    int r = 0, c = 0;
+    for (char ch : placement) {
+      if (ch == '/') {
+        if (c != 8)
+          throw invalid_argument("FEN rank " + to_string(r + 1) +
+                                 " does not have 8 files: " + fen);
+        r++;
+        c = 0;
+      } else if (ch >= '1' && ch <= '8') {
+        c += ch - '0';
+      } else {
+        size_t pc = PIECE_CHARS.find(tolower(ch));
+        if (pc == string::npos || r > 7 || c > 7)
+          throw invalid_argument("Bad FEN placement: " + fen);
+        pieces[isupper(ch) ? WHITE : BLACK][pc] |= 1ULL << (r * 8 + c);
+        c++;
+      }
+      if (c > 8)
+        throw invalid_argument("Bad FEN placement: " + fen);
+    }
+    if (r != 7 || c != 8)
+      throw invalid_argument("FEN placement does not cover 8 ranks: " + fen);
+    if (side != "w" && side != "b")
+      throw invalid_argument("FEN side to move must be w or b: " + fen);
+
+    sync_board();
+    turn_col = side == "w" ? WHITE : BLACK;
+
+    // Drop rights whose king or rook is not on its home square
+    castling = 0;
+    for (char ch : rights) {
+      if (ch == 'K' && piece_at(WHITE, 60) == K && piece_at(WHITE, 63) == R)
+        castling |= 1;
+      if (ch == 'Q' && piece_at(WHITE, 60) == K && piece_at(WHITE, 56) == R)
+        castling |= 2;
+      if (ch == 'k' && piece_at(BLACK, 4) == K && piece_at(BLACK, 7) == R)
+        castling |= 4;
+      if (ch == 'q' && piece_at(BLACK, 4) == K && piece_at(BLACK, 0) == R)
+        castling |= 8;
+    }
+
+    ep_square = -1;
+    if (ep != "-") {
+      if (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' ||
+          ep[1] != (turn_col == WHITE ? '6' : '3'))
+        throw invalid_argument("Bad FEN en passant square: " + fen);
+      ep_square = ('8' - ep[1]) * 8 + (ep[0] - 'a');
+    }
+
+    if (count_bits(pieces[WHITE][K]) != 1 ||
+        count_bits(pieces[BLACK][K]) != 1)
+      throw invalid_argument("FEN needs exactly one king per side: " + fen);
+    if ((pieces[WHITE][P] | pieces[BLACK][P]) & 0xFF000000000000FFULL)
+      throw invalid_argument("FEN has a pawn on a back rank: " + fen);
+    if (in_check_col(enemy_col(turn_col)))
+      throw invalid_argument("FEN side not to move is in check: " + fen);
+
+    hash_key = compute_hash();
+    pawn_key = compute_pawn_key();
+    psqt = compute_psqt();
+    halfmove_clock = halfmove;
+    plies_from_null = 0;
+    game_ply_base = 2 * (max(fullmove, 1) - 1) + turn_col;
+    undo_stack.clear();
+    game_over = false;
+    winner = "";
+    draw_reason = "";
+    attach_nnue(nnue);
+  }
+
+  string get_fen() const {
+    static const char PIECE_CHARS[] = "PNBRQKpnbrqk";
+    string fen;
+    for (int r = 0; r < 8; r++) {
+      int empty = 0;
+      for (int c = 0; c < 8; c++) {
+        int pc = board[r * 8 + c];
+        if (pc == NO_PIECE) {
+          empty++;
+          continue;
+        }
+        if (empty)
+          fen += char('0' + empty);
+        empty = 0;
+        fen += PIECE_CHARS[pc];
+      }
+      if (empty)
+        fen += char('0' + empty);
+      if (r < 7)
+        fen += '/';
+    }
+
+    fen += turn_col == WHITE ? " w " : " b ";
+    if (castling & 1)
+      fen += 'K';
+    if (castling & 2)
+      fen += 'Q';
+    if (castling & 4)
+      fen += 'k';
+    if (castling & 8)
+      fen += 'q';
+    if (!castling)
+      fen += '-';
+
+    if (ep_square == -1) {
+      fen += " -";
+    } else {
+      fen += ' ';
+      fen += char('a' + ep_square % 8);
+      fen += char('8' - ep_square / 8);
+    }
+
+    int game_ply = game_ply_base + (int)undo_stack.size();
+    fen += " " + to_string(halfmove_clock) + " " + to_string(game_ply / 2 + 1);
+    return fen;
+  }
+
+  // Full Zobrist key from scratch (setup and debug verification only)
+  U64 compute_hash() const {
+    U64 h = 0;
+    for (int color = 0; color < 2; color++) {
+      for (int piece = 0; piece < 6; piece++) {
+        U64 bb = pieces[color][piece];
+        while (bb) {
+          int sq = bb_ctzll(bb);
+          h ^= zobrist_pieces[color][piece][sq];
+          bb &= bb - 1;
+        }
+      }
+    }
+    if (turn_col == BLACK)
+      h ^= zobrist_side;
+    if (ep_square >= 0 && ep_square < 64)
+      h ^= zobrist_ep[ep_square];
+    h ^= zobrist_castling[castling & 0xF];
+    return h;
+  }
+
+  U64 compute_pawn_key() const {
+    U64 h = 0;
+    for (int color = 0; color < 2; color++) {
+      U64 bb = pieces[color][P];
+      while (bb) {
+        h ^= zobrist_pieces[color][P][bb_ctzll(bb)];
+        bb &= bb - 1;
+      }
+    }
+    return h;
+  }
+
+  Psqt compute_psqt() const {
+    Psqt ps;
+    for (int color = 0; color < 2; color++)
+      for (int type = 0; type < 6; type++)
+        for (U64 bb = pieces[color][type]; bb; bb &= bb - 1) {
+          int sq = bb_ctzll(bb) ^ (color == WHITE ? 0 : 56);
+          if (type != K)
+            ps.material[color] += PIECE_VALUE[type];
+          ps.mg[color] += PST_MG[type][sq];
+          ps.eg[color] += PST_EG[type][sq];
+        }
+    return ps;
+  }
+
+  // True if the top accumulator matches a full refresh of both sides
+  bool nnue_in_sync() const {
+    NnueAccumulator full;
+    for (int p = 0; p < 2; p++)
+      nnue->refresh(pieces, p, full.v[p]);
+    return !memcmp(&full, &nnue_stack.back(), sizeof(full));
+  }
+
+  // Evaluate with `net` from here on (nullptr detaches)
+  void attach_nnue(const NnueNetwork *net) {
+    nnue = net;
+    nnue_stack.clear();
+    if (!net)
+      return;
+    nnue_stack.reserve(256);
+    nnue_stack.emplace_back();
+    for (int p = 0; p < 2; p++)
+      net->refresh(pieces, p, nnue_stack.back().v[p]);
+  }
+
+  // Accumulator after `m` (already made): the parent's, updated by the
+  // non-king pieces that changed. Every feature depends on the own king
+  // square, so the mover's perspective is rebuilt after a king move.
+  void nnue_push(Move m, int color, int moved, int captured) {
+    int sq = move_from(m), tsq = move_to(m), flags = move_flags(m);
+    struct Change {
+      int color, type, sq;
+    } added[2], removed[2];
+    int n_added = 0, n_removed = 0;
+    if (moved != K) {
+      int promo = flags & FLAG_PROMO ? move_promo_piece(m) : moved;
+      removed[n_removed++] = {color, moved, sq};
+      added[n_added++] = {color, promo, tsq};
+    } else if (flags == FLAG_KING_CASTLE || flags == FLAG_QUEEN_CASTLE) {
+      int rank_base = sq & ~7;
+      bool king_side = flags == FLAG_KING_CASTLE;
+      removed[n_removed++] = {color, R, rank_base + (king_side ? 7 : 0)};
+      added[n_added++] = {color, R, rank_base + (king_side ? 5 : 3)};
+    }
+    if (captured != NO_PIECE) {
+      int cap_sq = tsq;
+      if (flags == FLAG_EP_CAPTURE)
+        cap_sq = (color == WHITE) ? tsq + 8 : tsq - 8;
+      removed[n_removed++] = {color ^ 1, piece_type(captured), cap_sq};
+    }
+
+    size_t n = nnue_stack.size();
+    nnue_stack.resize(n + 1);
+    NnueAccumulator &acc = nnue_stack[n];
+    acc = nnue_stack[n - 1];
+    for (int p = 0; p < 2; p++) {
+      if (moved == K && p == color) {
+        nnue->refresh(pieces, p, acc.v[p]);
+        continue;
+      }
+      int ksq = bb_ctzll(pieces[p][K]);
+      for (int i = 0; i < n_removed; i++)
+        nnue->sub(acc.v[p], NnueNetwork::feature(p, ksq, removed[i].color,
+                                                 removed[i].type,
+                                                 removed[i].sq));
+      for (int i = 0; i < n_added; i++)
+        nnue->add(acc.v[p], NnueNetwork::feature(p, ksq, added[i].color,
+                                                 added[i].type, added[i].sq));
+    }
+    DEBUG_ASSERT(nnue_in_sync());
+  }
+
+  // Rebuild colour/occupancy bitboards and the mailbox from `pieces`
+  void sync_board() {
+    occupied = 0;
+    for (int sq = 0; sq < 64; sq++)
+      board[sq] = NO_PIECE;
+    for (int i = 0; i < 2; i++) {
+      colors[i] = 0;
+      for (int j = 0; j < 6; j++) {
+        colors[i] |= pieces[i][j];
+        U64 bb = pieces[i][j];
+        while (bb) {
+          board[bb_ctzll(bb)] = make_piece(i, j);
+          bb &= bb - 1;
+        }
+      }
+    }
+    occupied = colors[WHITE] | colors[BLACK];
   }
 
   // --- PYTHON / LEGACY COMPATIBILITY METHODS ---
 
   vector<vector<string>> get_board() const {
+    static const char PIECE_CHARS[] = "PNBRQK";
     vector<vector<string>> b(8, vector<string>(8, "--"));
     for (int sq = 0; sq < 64; sq++) {
-      U64 bit = 1ULL << sq;
-      if (bit & occupied) {
-        int r = sq / 8;
-        int c = sq % 8;
-        int col = (bit & colors[WHITE]) ? WHITE : BLACK;
-        string cStr = (col == WHITE) ? "w" : "b";
-        if (bit & pieces[col][P])
-          b[r][c] = cStr + "P";
-        else if (bit & pieces[col][N])
-          b[r][c] = cStr + "N";
-        else if (bit & pieces[col][B])
-          b[r][c] = cStr + "B";
-        else if (bit & pieces[col][R])
-          b[r][c] = cStr + "R";
-        else if (bit & pieces[col][Q])
-          b[r][c] = cStr + "Q";
-        else if (bit & pieces[col][K])
-          b[r][c] = cStr + "K";
+      int pc = board[sq];
+      if (pc != NO_PIECE) {
+        b[sq / 8][sq % 8] = string(1, piece_color(pc) == WHITE ? 'w' : 'b') +
+                            PIECE_CHARS[piece_type(pc)];
       }
     }
     return b;
@@ -136,9 +485,51 @@ public:
   string enemy(const string &color) const { return color == "w" ? "b" : "w"; }
   int enemy_col(int color) const { return color ^ 1; }
 
-  vector<MoveFull> get_pseudo_moves(int color) const {
-    vector<MoveFull> moves;
+  // Quiet queen promotions count as tactical moves so quiescence sees them;
+  // quiet under-promotions are left to the quiet stage.
+  template <GenType T>
+  static void add_promotions(MoveList &moves, int sq, int tsq, int flags) {
+    bool capture = flags & FLAG_CAPTURE;
+    if (T != GEN_QUIETS)
+      moves.add(encode_move(sq, tsq, flags | (Q - N)));
+    if (T == GEN_ALL || (T == GEN_CAPTURES && capture) ||
+        (T == GEN_QUIETS && !capture)) {
+      moves.add(encode_move(sq, tsq, flags | (R - N)));
+      moves.add(encode_move(sq, tsq, flags | (B - N)));
+      moves.add(encode_move(sq, tsq, flags));
+    }
+  }
+
+  void add_piece_moves(MoveList &moves, int sq, U64 att) const {
+    while (att) {
+      int tsq = get_ls1b(att);
+      moves.add(encode_move(
+          sq, tsq, (occupied & (1ULL << tsq)) ? FLAG_CAPTURE : FLAG_QUIET));
+      att &= att - 1;
+    }
+  }
+
+  bool can_castle(int color, bool kingside) const {
     int enemy = enemy_col(color);
+    int base = (color == WHITE) ? 56 : 0;
+    int right = (kingside ? 1 : 2) << (color == WHITE ? 0 : 2);
+    if (!(castling & right))
+      return false;
+    U64 between = kingside ? (3ULL << (base + 5)) : (7ULL << (base + 1));
+    if (occupied & between)
+      return false;
+    int step = kingside ? 1 : -1;
+    return !is_attacked(base + 4, enemy) &&
+           !is_attacked(base + 4 + step, enemy) &&
+           !is_attacked(base + 4 + 2 * step, enemy);
+  }
+
+  // Appends pseudo-legal moves of the requested kind to `moves`
+  template <GenType T> void generate_moves(int color, MoveList &moves) const {
+    int enemy = enemy_col(color);
+    U64 targets = (T == GEN_CAPTURES) ? colors[enemy]
+                  : (T == GEN_QUIETS) ? ~occupied
+                                      : ~colors[color];
 
     U64 p = pieces[color][P];
     while (p) {
@@ -147,45 +538,37 @@ public:
       int push_dir = (color == WHITE) ? -8 : 8;
       int push_sq = sq + push_dir;
       if (!(occupied & (1ULL << push_sq))) {
-        int r = sq / 8, c = sq % 8;
-        int tr = push_sq / 8, tc = push_sq % 8;
+        int r = sq / 8;
+        int tr = push_sq / 8;
         if (tr == 0 || tr == 7) {
-          moves.push_back({r, c, tr, tc, "Q"});
-          moves.push_back({r, c, tr, tc, "R"});
-          moves.push_back({r, c, tr, tc, "B"});
-          moves.push_back({r, c, tr, tc, "N"});
-        } else {
-          moves.push_back({r, c, tr, tc, ""});
+          add_promotions<T>(moves, sq, push_sq, FLAG_PROMO);
+        } else if (T != GEN_CAPTURES) {
+          moves.add(encode_move(sq, push_sq, FLAG_QUIET));
           if ((color == WHITE && r == 6) || (color == BLACK && r == 1)) {
             int dp_sq = push_sq + push_dir;
             if (!(occupied & (1ULL << dp_sq))) {
-              moves.push_back({r, c, dp_sq / 8, dp_sq % 8, ""});
+              moves.add(encode_move(sq, dp_sq, FLAG_DOUBLE_PUSH));
             }
           }
         }
       }
+      U64 ep_bb = (ep_square != -1) ? (1ULL << ep_square) : 0;
       U64 caps = 0;
       if (color == WHITE) {
-        caps |= (sq_bb >> 7) & ~FILE_A &
-                (colors[BLACK] | (ep_square != -1 ? (1ULL << ep_square) : 0));
-        caps |= (sq_bb >> 9) & ~FILE_H &
-                (colors[BLACK] | (ep_square != -1 ? (1ULL << ep_square) : 0));
+        caps |= (sq_bb >> 7) & ~FILE_A & (colors[BLACK] | ep_bb);
+        caps |= (sq_bb >> 9) & ~FILE_H & (colors[BLACK] | ep_bb);
       } else {
-        caps |= (sq_bb << 9) & ~FILE_A &
-                (colors[WHITE] | (ep_square != -1 ? (1ULL << ep_square) : 0));
-        caps |= (sq_bb << 7) & ~FILE_H &
-                (colors[WHITE] | (ep_square != -1 ? (1ULL << ep_square) : 0));
+        caps |= (sq_bb << 9) & ~FILE_A & (colors[WHITE] | ep_bb);
+        caps |= (sq_bb << 7) & ~FILE_H & (colors[WHITE] | ep_bb);
       }
       while (caps) {
         int tsq = get_ls1b(caps);
-        int r = sq / 8, c = sq % 8, tr = tsq / 8, tc = tsq % 8;
+        int tr = tsq / 8;
         if (tr == 0 || tr == 7) {
-          moves.push_back({r, c, tr, tc, "Q"});
-          moves.push_back({r, c, tr, tc, "R"});
-          moves.push_back({r, c, tr, tc, "B"});
-          moves.push_back({r, c, tr, tc, "N"});
-        } else {
-          moves.push_back({r, c, tr, tc, ""});
+          add_promotions<T>(moves, sq, tsq, FLAG_PROMO_CAPTURE);
+        } else if (T != GEN_QUIETS) {
+          moves.add(encode_move(
+              sq, tsq, tsq == ep_square ? FLAG_EP_CAPTURE : FLAG_CAPTURE));
         }
         caps &= caps - 1;
       }
@@ -195,86 +578,110 @@ public:
     U64 n = pieces[color][N];
     while (n) {
       int sq = get_ls1b(n);
-      U64 att = knight_attacks[sq] & ~colors[color];
-      while (att) {
-        int tsq = get_ls1b(att);
-        moves.push_back({sq / 8, sq % 8, tsq / 8, tsq % 8, ""});
-        att &= att - 1;
-      }
+      add_piece_moves(moves, sq, knight_attacks[sq] & targets);
       n &= n - 1;
     }
 
     U64 b = pieces[color][B];
     while (b) {
       int sq = get_ls1b(b);
-      U64 att = get_bishop_attacks(sq, occupied) & ~colors[color];
-      while (att) {
-        int tsq = get_ls1b(att);
-        moves.push_back({sq / 8, sq % 8, tsq / 8, tsq % 8, ""});
-        att &= att - 1;
-      }
+      add_piece_moves(moves, sq, get_bishop_attacks(sq, occupied) & targets);
       b &= b - 1;
     }
 
     U64 rk = pieces[color][R];
     while (rk) {
       int sq = get_ls1b(rk);
-      U64 att = get_rook_attacks(sq, occupied) & ~colors[color];
-      while (att) {
-        int tsq = get_ls1b(att);
-        moves.push_back({sq / 8, sq % 8, tsq / 8, tsq % 8, ""});
-        att &= att - 1;
-      }
+      add_piece_moves(moves, sq, get_rook_attacks(sq, occupied) & targets);
       rk &= rk - 1;
     }
 
     U64 q = pieces[color][Q];
     while (q) {
       int sq = get_ls1b(q);
-      U64 att = get_queen_attacks(sq, occupied) & ~colors[color];
-      while (att) {
-        int tsq = get_ls1b(att);
-        moves.push_back({sq / 8, sq % 8, tsq / 8, tsq % 8, ""});
-        att &= att - 1;
-      }
+      add_piece_moves(moves, sq, get_queen_attacks(sq, occupied) & targets);
       q &= q - 1;
     }
 
     U64 k = pieces[color][K];
     if (k) {
       int sq = get_ls1b(k);
-      U64 att = king_attacks[sq] & ~colors[color];
-      while (att) {
-        int tsq = get_ls1b(att);
-        moves.push_back({sq / 8, sq % 8, tsq / 8, tsq % 8, ""});
-        att &= att - 1;
+      add_piece_moves(moves, sq, king_attacks[sq] & targets);
+
+      if (T != GEN_CAPTURES) {
+        if (can_castle(color, true))
+          moves.add(encode_move(sq, sq + 2, FLAG_KING_CASTLE));
+        if (can_castle(color, false))
+          moves.add(encode_move(sq, sq - 2, FLAG_QUEEN_CASTLE));
       }
+    }
+  }
 
-      if (!is_attacked(sq, enemy)) {
-        if (color == WHITE) {
-          if ((castling & 1) && !(occupied & ((1ULL << 61) | (1ULL << 62))) &&
-              !is_attacked(61, BLACK) && !is_attacked(62, BLACK)) {
-            moves.push_back({7, 4, 7, 6, ""});
-          }
-          if ((castling & 2) &&
-              !(occupied & ((1ULL << 57) | (1ULL << 58) | (1ULL << 59))) &&
-              !is_attacked(59, BLACK) && !is_attacked(58, BLACK)) {
-            moves.push_back({7, 4, 7, 2, ""});
-          }
-        } else {
-          if ((castling & 4) && !(occupied & ((1ULL << 5) | (1ULL << 6))) &&
-              !is_attacked(5, WHITE) && !is_attacked(6, WHITE)) {
-            moves.push_back({0, 4, 0, 6, ""});
-          }
-          if ((castling & 8) &&
-              !(occupied & ((1ULL << 1) | (1ULL << 2) | (1ULL << 3))) &&
-              !is_attacked(3, WHITE) && !is_attacked(2, WHITE)) {
-            moves.push_back({0, 4, 0, 2, ""});
-          }
-        }
+  void get_pseudo_moves(int color, MoveList &moves) const {
+    moves.count = 0;
+    generate_moves<GEN_ALL>(color, moves);
+  }
+
+  // Cheap validity test for moves that did not come from the generator
+  // (hash and killer moves): true if `m` is pseudo-legal for the side to
+  // move in the current position.
+  bool is_pseudo_legal(Move m) const {
+    if (m == NO_MOVE)
+      return false;
+    int color = turn_col;
+    int enemy = enemy_col(color);
+    int sq = move_from(m);
+    int tsq = move_to(m);
+    int flags = move_flags(m);
+    U64 tsq_bb = 1ULL << tsq;
+    if (flags > FLAG_EP_CAPTURE && flags < FLAG_PROMO)
+      return false; // unassigned codes
+
+    int piece = piece_at(color, sq);
+    if (piece == -1 || (colors[color] & tsq_bb))
+      return false;
+
+    if (flags == FLAG_EP_CAPTURE)
+      return piece == P && tsq == ep_square &&
+             (pawn_attacks[color][sq] & tsq_bb);
+    if (((flags & FLAG_CAPTURE) != 0) != ((colors[enemy] & tsq_bb) != 0))
+      return false;
+
+    if (flags == FLAG_KING_CASTLE || flags == FLAG_QUEEN_CASTLE) {
+      bool king_side = flags == FLAG_KING_CASTLE;
+      return piece == K && sq == ((color == WHITE) ? 60 : 4) &&
+             tsq == sq + (king_side ? 2 : -2) && can_castle(color, king_side);
+    }
+
+    if (piece == P) {
+      int push_dir = (color == WHITE) ? -8 : 8;
+      int tr = tsq / 8;
+      if (((flags & FLAG_PROMO) != 0) != (tr == 0 || tr == 7))
+        return false;
+      if (flags & FLAG_CAPTURE)
+        return (pawn_attacks[color][sq] & tsq_bb) != 0;
+      if (flags == FLAG_DOUBLE_PUSH) {
+        int start_rank = (color == WHITE) ? 6 : 1;
+        return sq / 8 == start_rank && tsq == sq + 2 * push_dir &&
+               !(occupied & ((1ULL << (sq + push_dir)) | tsq_bb));
       }
+      return tsq == sq + push_dir && !(occupied & tsq_bb);
     }
-    return moves;
+
+    if (flags != FLAG_QUIET && flags != FLAG_CAPTURE)
+      return false;
+    U64 att = 0;
+    if (piece == N)
+      att = knight_attacks[sq];
+    else if (piece == B)
+      att = get_bishop_attacks(sq, occupied);
+    else if (piece == R)
+      att = get_rook_attacks(sq, occupied);
+    else if (piece == Q)
+      att = get_queen_attacks(sq, occupied);
+    else
+      att = king_attacks[sq];
+    return (att & tsq_bb) != 0;
   }
 
   U64 get_attacks(int color) const {
@@ -348,36 +755,104 @@ public:
     return is_attacked(bb_ctzll(k), enemy_col(color));
   }
 
-  // Engine State Backup for Search
-  struct EngineState {
-    U64 pieces[2][6];
-    U64 colors[2];
-    U64 occupied;
-    int ep_square;
-    int castling;
+  // All pieces (both colours) attacking `sq` with the given occupancy
+  U64 attackers_to(int sq, U64 occ) const {
+    return (pawn_attacks[BLACK][sq] & pieces[WHITE][P]) |
+           (pawn_attacks[WHITE][sq] & pieces[BLACK][P]) |
+           (knight_attacks[sq] & (pieces[WHITE][N] | pieces[BLACK][N])) |
+           (king_attacks[sq] & (pieces[WHITE][K] | pieces[BLACK][K])) |
+           (get_bishop_attacks(sq, occ) &
+            (pieces[WHITE][B] | pieces[BLACK][B] | pieces[WHITE][Q] |
+             pieces[BLACK][Q])) |
+           (get_rook_attacks(sq, occ) &
+            (pieces[WHITE][R] | pieces[BLACK][R] | pieces[WHITE][Q] |
+             pieces[BLACK][Q]));
+  }
+
+  // Legality data for the side to move, computed once per position
+  struct CheckInfo {
+    int king_sq;
+    U64 checkers;   // enemy pieces giving check
+    U64 pinned;     // own pieces pinned against the king
+    U64 check_mask; // target squares that resolve a single check
   };
-  EngineState save_state() const {
-    EngineState st;
-    for (int i = 0; i < 2; i++) {
-      st.colors[i] = colors[i];
-      for (int j = 0; j < 6; j++)
-        st.pieces[i][j] = pieces[i][j];
+
+  CheckInfo compute_check_info() const {
+    CheckInfo ci;
+    int color = turn_col;
+    int enemy = enemy_col(color);
+    ci.king_sq = bb_ctzll(pieces[color][K]);
+    ci.checkers = attackers_to(ci.king_sq, occupied) & colors[enemy];
+    ci.pinned = 0;
+
+    U64 snipers =
+        (get_rook_attacks(ci.king_sq, colors[enemy]) &
+         (pieces[enemy][R] | pieces[enemy][Q])) |
+        (get_bishop_attacks(ci.king_sq, colors[enemy]) &
+         (pieces[enemy][B] | pieces[enemy][Q]));
+    while (snipers) {
+      int sq = bb_ctzll(snipers);
+      U64 blockers = between_bb[ci.king_sq][sq] & occupied;
+      if (blockers && !(blockers & (blockers - 1)) &&
+          (blockers & colors[color]))
+        ci.pinned |= blockers;
+      snipers &= snipers - 1;
     }
-    st.occupied = occupied;
-    st.ep_square = ep_square;
-    st.castling = castling;
-    return st;
+
+    if (!ci.checkers)
+      ci.check_mask = ~0ULL;
+    else if (ci.checkers & (ci.checkers - 1))
+      ci.check_mask = 0; // double check: only king moves
+    else
+      ci.check_mask =
+          ci.checkers | between_bb[ci.king_sq][bb_ctzll(ci.checkers)];
+    return ci;
   }
-  void restore_state(const EngineState &st, int turn_col_saved) {
-    for (int i = 0; i < 2; i++) {
-      colors[i] = st.colors[i];
-      for (int j = 0; j < 6; j++)
-        pieces[i][j] = st.pieces[i][j];
+
+  // Full legality test for a pseudo-legal move of the side to move
+  bool is_legal(Move m, const CheckInfo &ci) const {
+    int sq = move_from(m);
+    int tsq = move_to(m);
+    int flags = move_flags(m);
+    int enemy = enemy_col(turn_col);
+
+    if (sq == ci.king_sq) {
+      if (flags == FLAG_KING_CASTLE || flags == FLAG_QUEEN_CASTLE)
+        return true; // can_castle already checked the path
+      return !(attackers_to(tsq, occupied ^ (1ULL << sq)) & colors[enemy]);
     }
-    occupied = st.occupied;
-    ep_square = st.ep_square;
-    castling = st.castling;
-    turn_col = turn_col_saved;
+
+    if (flags == FLAG_EP_CAPTURE) {
+      // Captured pawn and mover both leave their squares: re-test the king
+      // from scratch (covers discovered checks along the rank)
+      int cap_sq = (turn_col == WHITE) ? tsq + 8 : tsq - 8;
+      U64 occ = (occupied ^ (1ULL << sq) ^ (1ULL << cap_sq)) | (1ULL << tsq);
+      return !(attackers_to(ci.king_sq, occ) & colors[enemy] &
+               ~(1ULL << cap_sq));
+    }
+
+    if (!(ci.check_mask & (1ULL << tsq)))
+      return false;
+    return !(ci.pinned & (1ULL << sq)) ||
+           (line_bb[ci.king_sq][sq] & (1ULL << tsq));
+  }
+
+  // Appends the legal moves of the requested kind for the side to move
+  template <GenType T>
+  void generate_legal(MoveList &moves, const CheckInfo &ci) const {
+    int first = moves.count;
+    generate_moves<T>(turn_col, moves);
+    int n = first;
+    for (int i = first; i < moves.count; i++) {
+      if (is_legal(moves.moves[i], ci))
+        moves.moves[n++] = moves.moves[i];
+    }
+    moves.count = n;
+  }
+
+  void get_legal_moves(MoveList &moves) const {
+    moves.count = 0;
+    generate_legal<GEN_ALL>(moves, compute_check_info());
   }
 
   bool in_check(const string &color) {
@@ -389,196 +864,342 @@ public:
       return py::make_tuple(py::list(), py::list());
     vector<Square> lm, lc;
     int sq = r * 8 + c;
-    U64 sq_bb = 1ULL << sq;
-    int p_color = -1;
-    if (colors[WHITE] & sq_bb)
-      p_color = WHITE;
-    else if (colors[BLACK] & sq_bb)
-      p_color = BLACK;
-    if (p_color == -1)
+    if (!(colors[turn_col] & (1ULL << sq)))
       return py::make_tuple(lm, lc);
 
-    auto pms = get_pseudo_moves(p_color);
-    for (auto &m : pms) {
-      if (get<0>(m) == r && get<1>(m) == c) {
-        int tr = get<2>(m);
-        int tc = get<3>(m);
-        auto st = save_state();
-        int tc_save = turn_col;
-
-        make_move_fast(r, c, tr, tc, get<4>(m));
-        bool in_check_after =
-            is_attacked(bb_ctzll(pieces[p_color][K]), enemy_col(p_color));
-        restore_state(st, tc_save);
-
-        if (!in_check_after) {
-          int tsq = tr * 8 + tc;
-          bool cap = false;
-          if (colors[enemy_col(p_color)] & (1ULL << tsq))
-            cap = true;
-          else if ((pieces[p_color][P] & sq_bb) && abs(tc - c) == 1)
-            cap = true;
-
-          if (cap)
-            lc.push_back({tr, tc});
-          else
-            lm.push_back({tr, tc});
-        }
-      }
+    MoveList moves;
+    get_legal_moves(moves);
+    for (Move m : moves) {
+      if (move_from(m) != sq)
+        continue;
+      // Promotions are reported once per target square
+      if (move_is_promo(m) && move_promo_piece(m) != Q)
+        continue;
+      int tsq = move_to(m);
+      if (move_is_capture(m))
+        lc.push_back({tsq / 8, tsq % 8});
+      else
+        lm.push_back({tsq / 8, tsq % 8});
     }
     return py::make_tuple(lm, lc);
   }
 
   bool has_legal_moves(const string &color_str) {
     int color = (color_str == "w") ? WHITE : BLACK;
-    auto pms = get_pseudo_moves(color);
-    for (auto &m : pms) {
-      auto st = save_state();
-      int tc_save = turn_col;
-      make_move_fast(get<0>(m), get<1>(m), get<2>(m), get<3>(m), get<4>(m));
-      bool in_check_after =
-          is_attacked(bb_ctzll(pieces[color][K]), enemy_col(color));
-      restore_state(st, tc_save);
-      if (!in_check_after)
-        return true;
-    }
-    return false;
+    int saved_turn = turn_col;
+    turn_col = color;
+    MoveList moves;
+    get_legal_moves(moves);
+    turn_col = saved_turn;
+    return moves.count > 0;
   }
 
   bool check_game_over() {
     if (!has_legal_moves(turn_col == WHITE ? "w" : "b")) {
       game_over = true;
-      if (in_check_col(turn_col))
+      if (in_check_col(turn_col)) {
         winner = enemy(turn_col == WHITE ? "w" : "b");
-      else
+      } else {
         winner = "draw";
+        draw_reason = "stalemate";
+      }
+      return true;
+    }
+    if (halfmove_clock >= 100 || is_repetition(0)) {
+      game_over = true;
+      winner = "draw";
+      draw_reason = halfmove_clock >= 100 ? "fifty-move rule" : "repetition";
       return true;
     }
     return false;
   }
 
+  // True if the position occurred before, looking back through the undo
+  // stack (game moves followed by the search line) no further than the
+  // last capture, pawn move or null move. A repeat within the last `ply`
+  // plies, i.e. inside the search tree, counts at once; one from before
+  // the root must have occurred twice, i.e. be a threefold repetition.
+  bool is_repetition(int ply) const {
+    int n = (int)undo_stack.size();
+    int end = min(min(halfmove_clock, plies_from_null), n);
+    int count = 0;
+    for (int i = 4; i <= end; i += 2) {
+      if (undo_stack[n - i].hash_key == hash_key && (i <= ply || ++count == 2))
+        return true;
+    }
+    return false;
+  }
+
+  // Draw by repetition or by the fifty-move rule, unless the last move
+  // before the fifty-move limit gave mate
+  bool is_draw(int ply) {
+    if (halfmove_clock >= 100) {
+      if (!in_check_col(turn_col))
+        return true;
+      MoveList moves;
+      get_legal_moves(moves);
+      return moves.count > 0;
+    }
+    return is_repetition(ply);
+  }
+
+  // Type of `color`'s piece on `sq`, or -1
+  int piece_at(int color, int sq) const {
+    int pc = board[sq];
+    return (pc != NO_PIECE && piece_color(pc) == color) ? piece_type(pc) : -1;
+  }
+
+  void put_piece(int color, int type, int sq) {
+    U64 sq_bb = 1ULL << sq;
+    pieces[color][type] ^= sq_bb;
+    colors[color] ^= sq_bb;
+    occupied ^= sq_bb;
+    board[sq] = make_piece(color, type);
+    hash_key ^= zobrist_pieces[color][type][sq];
+    if (type == P)
+      pawn_key ^= zobrist_pieces[color][P][sq];
+    int psq = color == WHITE ? sq : sq ^ 56;
+    if (type != K)
+      psqt.material[color] += PIECE_VALUE[type];
+    psqt.mg[color] += PST_MG[type][psq];
+    psqt.eg[color] += PST_EG[type][psq];
+  }
+
+  void remove_piece(int color, int type, int sq) {
+    U64 sq_bb = 1ULL << sq;
+    pieces[color][type] ^= sq_bb;
+    colors[color] ^= sq_bb;
+    occupied ^= sq_bb;
+    board[sq] = NO_PIECE;
+    hash_key ^= zobrist_pieces[color][type][sq];
+    if (type == P)
+      pawn_key ^= zobrist_pieces[color][P][sq];
+    int psq = color == WHITE ? sq : sq ^ 56;
+    if (type != K)
+      psqt.material[color] -= PIECE_VALUE[type];
+    psqt.mg[color] -= PST_MG[type][psq];
+    psqt.eg[color] -= PST_EG[type][psq];
+  }
+
+  void move_piece(int color, int type, int sq, int tsq) {
+    U64 move_bb = (1ULL << sq) | (1ULL << tsq);
+    pieces[color][type] ^= move_bb;
+    colors[color] ^= move_bb;
+    occupied ^= move_bb;
+    board[tsq] = board[sq];
+    board[sq] = NO_PIECE;
+    hash_key ^=
+        zobrist_pieces[color][type][sq] ^ zobrist_pieces[color][type][tsq];
+    if (type == P)
+      pawn_key ^= zobrist_pieces[color][P][sq] ^ zobrist_pieces[color][P][tsq];
+    int flip = color == WHITE ? 0 : 56;
+    psqt.mg[color] += PST_MG[type][tsq ^ flip] - PST_MG[type][sq ^ flip];
+    psqt.eg[color] += PST_EG[type][tsq ^ flip] - PST_EG[type][sq ^ flip];
+  }
+
+  // Build a packed move from board coordinates (Python boundary only)
+  Move encode_board_move(int sr, int sc, int tr, int tc,
+                         const string &promo = "") const {
+    int sq = sr * 8 + sc;
+    int tsq = tr * 8 + tc;
+    int moved_piece = piece_at(turn_col, sq);
+    int flags = FLAG_QUIET;
+    if (colors[enemy_col(turn_col)] & (1ULL << tsq))
+      flags = FLAG_CAPTURE;
+
+    if (moved_piece == K && abs(tc - sc) == 2) {
+      flags = (tc > sc) ? FLAG_KING_CASTLE : FLAG_QUEEN_CASTLE;
+    } else if (moved_piece == P) {
+      if (tsq == ep_square)
+        flags = FLAG_EP_CAPTURE;
+      else if (abs(tr - sr) == 2)
+        flags = FLAG_DOUBLE_PUSH;
+      if (!promo.empty() && promo != "None") {
+        int promo_piece = Q;
+        if (promo[0] == 'R')
+          promo_piece = R;
+        else if (promo[0] == 'B')
+          promo_piece = B;
+        else if (promo[0] == 'N')
+          promo_piece = N;
+        flags |= FLAG_PROMO | (promo_piece - N);
+      }
+    }
+    return encode_move(sq, tsq, flags);
+  }
+
   void make_move(int sr, int sc, int tr, int tc,
                  py::object promoted_piece_obj = py::none()) {
     string promo = "";
     if (!promoted_piece_obj.is_none())
       promo = promoted_piece_obj.cast<string>();
-    make_move_fast(sr, sc, tr, tc, promo);
+    make_move_fast(encode_board_move(sr, sc, tr, tc, promo));
     check_game_over();
   }
 
-  void make_move_fast(int sr, int sc, int tr, int tc,
-                      const string &promo = "") {
-    int sq = sr * 8 + sc;
-    int tsq = tr * 8 + tc;
+  void make_move_fast(Move m) {
+    int sq = move_from(m);
+    int tsq = move_to(m);
+    int flags = move_flags(m);
     int color = turn_col;
     int enemy = enemy_col(color);
-    U64 sq_bb = 1ULL << sq;
-    U64 tsq_bb = 1ULL << tsq;
 
-    int moved_piece = -1;
-    for (int i = 0; i < 6; i++) {
-      if (pieces[color][i] & sq_bb) {
-        moved_piece = i;
-        break;
-      }
-    }
+    int moved_piece = piece_at(color, sq);
     if (moved_piece == -1)
       return;
 
-    int captured_piece = -1;
-    for (int i = 0; i < 6; i++) {
-      if (pieces[enemy][i] & tsq_bb) {
-        captured_piece = i;
-        break;
-      }
-    }
+    undo_stack.push_back({hash_key, ep_square, castling, halfmove_clock,
+                          plies_from_null, (uint8_t)NO_PIECE});
+    UndoInfo &undo = undo_stack.back();
+    halfmove_clock++;
+    plies_from_null++;
 
-    pieces[color][moved_piece] ^= (sq_bb | tsq_bb);
-    if (captured_piece != -1) {
-      pieces[enemy][captured_piece] ^= tsq_bb;
+    if (flags & FLAG_CAPTURE) {
+      int cap_sq = tsq;
+      if (flags == FLAG_EP_CAPTURE)
+        cap_sq = (color == WHITE) ? tsq + 8 : tsq - 8;
+      undo.captured = board[cap_sq];
+      remove_piece(enemy, piece_type(board[cap_sq]), cap_sq);
+      halfmove_clock = 0;
     }
 
-    if (!promo.empty() && promo != "None") {
-      pieces[color][P] ^= tsq_bb;
-      if (promo[0] == 'Q')
-        pieces[color][Q] |= tsq_bb;
-      else if (promo[0] == 'R')
-        pieces[color][R] |= tsq_bb;
-      else if (promo[0] == 'B')
-        pieces[color][B] |= tsq_bb;
-      else if (promo[0] == 'N')
-        pieces[color][N] |= tsq_bb;
-    }
+    move_piece(color, moved_piece, sq, tsq);
+    if (moved_piece == P)
+      halfmove_clock = 0;
 
-    if (moved_piece == K && abs(tc - sc) == 2) {
-      if (tc > sc) {
-        pieces[color][R] ^= (1ULL << (sr * 8 + 7)) | (1ULL << (sr * 8 + 5));
-      } else {
-        pieces[color][R] ^= (1ULL << (sr * 8 + 0)) | (1ULL << (sr * 8 + 3));
-      }
+    if (flags & FLAG_PROMO) {
+      remove_piece(color, P, tsq);
+      put_piece(color, move_promo_piece(m), tsq);
     }
 
-    if (moved_piece == P && tsq == ep_square) {
-      int cap_sq = (color == WHITE) ? tsq + 8 : tsq - 8;
-      pieces[enemy][P] ^= (1ULL << cap_sq);
+    int rank_base = sq & ~7;
+    if (flags == FLAG_KING_CASTLE) {
+      move_piece(color, R, rank_base + 7, rank_base + 5);
+    } else if (flags == FLAG_QUEEN_CASTLE) {
+      move_piece(color, R, rank_base + 0, rank_base + 3);
     }
 
+    if (ep_square != -1)
+      hash_key ^= zobrist_ep[ep_square];
     ep_square = -1;
-    if (moved_piece == P && abs(tr - sr) == 2) {
-      ep_square = (tr + sr) / 2 * 8 + sc;
+    if (flags == FLAG_DOUBLE_PUSH) {
+      ep_square = (sq + tsq) / 2;
+      hash_key ^= zobrist_ep[ep_square];
     }
 
-    if (moved_piece == K) {
-      castling &= (color == WHITE) ? ~3 : ~12;
+    int new_castling = castling & CASTLING_MASK[sq] & CASTLING_MASK[tsq];
+    if (new_castling != castling) {
+      hash_key ^= zobrist_castling[castling] ^ zobrist_castling[new_castling];
+      castling = new_castling;
     }
-    if (moved_piece == R) {
-      if (color == WHITE) {
-        if (sc == 7)
-          castling &= ~1;
-        if (sc == 0)
-          castling &= ~2;
-      } else {
-        if (sc == 7)
-          castling &= ~4;
-        if (sc == 0)
-          castling &= ~8;
-      }
+
+    turn_col = enemy;
+    hash_key ^= zobrist_side;
+    DEBUG_ASSERT(hash_key == compute_hash());
+    DEBUG_ASSERT(pawn_key == compute_pawn_key());
+    DEBUG_ASSERT(psqt == compute_psqt());
+    if (nnue)
+      nnue_push(m, color, moved_piece, undo.captured);
+  }
+
+  // Reverse the last make_move_fast(m) from the undo stack
+  void unmake_move(Move m) {
+    const UndoInfo &undo = undo_stack.back();
+    if (nnue)
+      nnue_stack.pop_back();
+    int sq = move_from(m);
+    int tsq = move_to(m);
+    int flags = move_flags(m);
+    int color = enemy_col(turn_col);
+    int enemy = turn_col;
+
+    if (flags & FLAG_PROMO) {
+      remove_piece(color, move_promo_piece(m), tsq);
+      put_piece(color, P, tsq);
     }
-    if (captured_piece == R) {
-      if (enemy == WHITE) {
-        if (tc == 7 && tr == 7)
-          castling &= ~1;
-        if (tc == 0 && tr == 7)
-          castling &= ~2;
-      } else {
-        if (tc == 7 && tr == 0)
-          castling &= ~4;
-        if (tc == 0 && tr == 0)
-          castling &= ~8;
-      }
+
+    move_piece(color, piece_type(board[tsq]), tsq, sq);
+
+    int rank_base = sq & ~7;
+    if (flags == FLAG_KING_CASTLE) {
+      move_piece(color, R, rank_base + 5, rank_base + 7);
+    } else if (flags == FLAG_QUEEN_CASTLE) {
+      move_piece(color, R, rank_base + 3, rank_base + 0);
     }
 
-    colors[WHITE] = pieces[WHITE][P] | pieces[WHITE][N] | pieces[WHITE][B] |
-                    pieces[WHITE][R] | pieces[WHITE][Q] | pieces[WHITE][K];
-    colors[BLACK] = pieces[BLACK][P] | pieces[BLACK][N] | pieces[BLACK][B] |
-                    pieces[BLACK][R] | pieces[BLACK][Q] | pieces[BLACK][K];
-    occupied = colors[WHITE] | colors[BLACK];
+    if (undo.captured != NO_PIECE) {
+      int cap_sq = tsq;
+      if (flags == FLAG_EP_CAPTURE)
+        cap_sq = (color == WHITE) ? tsq + 8 : tsq - 8;
+      put_piece(enemy, piece_type(undo.captured), cap_sq);
+    }
 
-    turn_col = enemy;
+    turn_col = color;
+    ep_square = undo.ep_square;
+    castling = undo.castling;
+    halfmove_clock = undo.halfmove_clock;
+    plies_from_null = undo.plies_from_null;
+    hash_key = undo.hash_key;
+    undo_stack.pop_back();
+  }
+
+  // Pass the move to the opponent (null-move pruning)
+  void make_null_move() {
+    undo_stack.push_back({hash_key, ep_square, castling, halfmove_clock,
+                          plies_from_null, (uint8_t)NO_PIECE});
+    halfmove_clock++;
+    plies_from_null = 0;
+    if (ep_square != -1)
+      hash_key ^= zobrist_ep[ep_square];
+    ep_square = -1;
+    turn_col = enemy_col(turn_col);
+    hash_key ^= zobrist_side;
+    DEBUG_ASSERT(hash_key == compute_hash());
+  }
+
+  void unmake_null_move() {
+    const UndoInfo &undo = undo_stack.back();
+    turn_col = enemy_col(turn_col);
+    ep_square = undo.ep_square;
+    halfmove_clock = undo.halfmove_clock;
+    plies_from_null = undo.plies_from_null;
+    hash_key = undo.hash_key;
+    undo_stack.pop_back();
   }
 };
 
 #include "ai_engine.cpp"
+#include "perft.cpp"
 
 PYBIND11_MODULE(chess_engine_cpp, m) {
+  m.def("verify_slider_attacks", &verify_slider_attacks,
+        py::arg("samples") = 10000);
+  m.def("perft", &perft, py::arg("engine"), py::arg("depth"),
+        py::arg("threads") = 1, py::arg("hash_mb") = 0);
+  m.def("perft_divide", &perft_divide, py::arg("engine"), py::arg("depth"),
+        py::arg("threads") = 1, py::arg("hash_mb") = 0);
+  m.def(
+      "set_syzygy_path",
+      [](const string &path) { return SyzygyTablebases::load(path); },
+      py::arg("path"));
+  m.def("syzygy_max_pieces",
+        []() { return SyzygyTablebases::current()->max_pieces(); });
+  m.def("nnue_simd", []() { return nnue_simd_name(nnue_detect_simd()); });
+
   py::class_<ChessEngine>(m, "ChessEngine")
       .def(py::init<>())
       .def_property_readonly("board", &ChessEngine::get_board)
       .def_property_readonly("turn", &ChessEngine::get_turn)
       .def_property_readonly("en_passant", &ChessEngine::get_ep)
       .def_property_readonly("castle_rights", &ChessEngine::get_castle_rights)
+      .def("set_fen", &ChessEngine::set_fen)
+      .def("get_fen", &ChessEngine::get_fen)
+      .def("reset", &ChessEngine::reset_board)
       .def_readwrite("game_over", &ChessEngine::game_over)
       .def_readwrite("winner", &ChessEngine::winner)
+      .def_readonly("draw_reason", &ChessEngine::draw_reason)
+      .def_readonly("halfmove_clock", &ChessEngine::halfmove_clock)
+      .def("is_repetition", &ChessEngine::is_repetition, py::arg("ply") = 0)
       .def("in_bounds", &ChessEngine::in_bounds)
       .def("enemy", &ChessEngine::enemy)
       .def("in_check", &ChessEngine::in_check)
@@ -594,6 +1215,37 @@ PYBIND11_MODULE(chess_engine_cpp, m) {
            py::arg("time_limit") = 5.0)
       .def_readwrite("max_depth", &AlphaBetaEngine::max_depth)
       .def_readwrite("time_limit", &AlphaBetaEngine::time_limit)
+      .def_readwrite("clock", &AlphaBetaEngine::clock)
+      .def_readwrite("increment", &AlphaBetaEngine::increment)
+      .def_readwrite("moves_to_go", &AlphaBetaEngine::moves_to_go)
+      .def_readwrite("node_limit", &AlphaBetaEngine::node_limit)
+      .def_readwrite("threads", &AlphaBetaEngine::threads)
+      .def_readwrite("verbose", &AlphaBetaEngine::verbose)
+      .def_readwrite("persistent", &AlphaBetaEngine::persistent)
+      .def_readwrite("ponder", &AlphaBetaEngine::ponder)
+      .def_readwrite("use_book", &AlphaBetaEngine::use_book)
+      .def("load_book", &AlphaBetaEngine::load_book, py::arg("path"))
+      .def_readwrite("use_nnue", &AlphaBetaEngine::use_nnue)
+      .def("load_nnue", &AlphaBetaEngine::load_nnue, py::arg("path"))
+      .def("new_game", &AlphaBetaEngine::new_game)
+      .def_readonly("nodes_searched", &AlphaBetaEngine::nodes_searched)
+      .def_readonly("tb_hits", &AlphaBetaEngine::tb_hits)
+      .def_readonly("eval_probes", &AlphaBetaEngine::eval_probes)
+      .def_readonly("eval_hits", &AlphaBetaEngine::eval_hits)
+      .def_property(
+          "hash_mb", [](const AlphaBetaEngine &ai) { return ai.tt->size_mb(); },
+          [](AlphaBetaEngine &ai, size_t mb) {
+            ai._abort_search(); // the search thread probes the old table
+            ai.tt->resize(mb);
+          })
+      .def("hashfull",
+           [](const AlphaBetaEngine &ai) { return ai.tt->hashfull(); })
       .def("record_move", &AlphaBetaEngine::record_move)
-      .def("get_best_move", &AlphaBetaEngine::get_best_move);
+      .def_property_readonly("pv", &AlphaBetaEngine::get_pv)
+      .def("get_best_move", &AlphaBetaEngine::get_best_move)
+      .def("start_search", &AlphaBetaEngine::start_search, py::arg("engine"),
+           py::arg("callback") = py::none())
+      .def("poll", &AlphaBetaEngine::poll)
+      .def("wait", &AlphaBetaEngine::wait)
+      .def("stop", &AlphaBetaEngine::stop_search);
 }
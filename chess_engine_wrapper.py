@@ -1,4 +1,5 @@
 from chess_engine_cpp import ChessEngine as CppChessEngine, AlphaBetaEngine as CppAlphaBetaEngine
+from chess_engine_cpp import set_syzygy_path
 import time
 
 class ChessEngine(CppChessEngine):
@@ -11,12 +12,57 @@ class AlphaBetaEngine:
         
     def record_move(self, move):
         self._cpp_engine.record_move(move)
+
+    def new_game(self):
+        self._cpp_engine.new_game()
         
     def get_best_move(self, engine):
         return self._cpp_engine.get_best_move(engine)
 
+    def start_search(self, engine, callback=None):
+        self._cpp_engine.start_search(engine, callback)
+
+    def poll(self):
+        return self._cpp_engine.poll()
+
+    def wait(self):
+        return self._cpp_engine.wait()
+
+    def stop(self):
+        self._cpp_engine.stop()
+
     def set_depth(self, depth):
         self._cpp_engine.max_depth = depth
 
     def set_time_limit(self, limit):
         self._cpp_engine.time_limit = limit
+
+    def set_clock(self, remaining, increment=0.0, moves_to_go=0):
+        """Seconds left for the side to move; call before every search."""
+        self._cpp_engine.clock = remaining
+        self._cpp_engine.increment = increment
+        self._cpp_engine.moves_to_go = moves_to_go
+
+    def set_threads(self, threads):
+        self._cpp_engine.threads = threads
+
+    def set_ponder(self, enabled):
+        self._cpp_engine.ponder = enabled
+
+    def set_book(self, path, enabled=True):
+        """Load a Polyglot .bin opening book ("" unloads it)."""
+        self._cpp_engine.load_book(path)
+        self._cpp_engine.use_book = enabled
+
+    def set_nnue(self, path, enabled=True):
+        """Load a HalfKP .nnue network (Stockfish 12 format); "" unloads it
+        and the classical evaluation is used."""
+        self._cpp_engine.load_nnue(path)
+        self._cpp_engine.use_nnue = enabled
+
+    def set_syzygy_path(self, path):
+        """Directories of Syzygy tables, shared by every engine; returns how
+        many tables were found. Safe while a search or ponder search runs:
+        it finishes on the tables it started with, and the next search
+        uses the new ones."""
+        return set_syzygy_path(path)
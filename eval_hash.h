@@ -0,0 +1,37 @@
+#ifndef EVAL_HASH_H
+#define EVAL_HASH_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "bitboard.h"
+
+// Lossy cache of static evaluations, indexed by the low bits of the
+// Zobrist key. Each slot is one word: the upper 48 key bits beside the
+// 16-bit score, so a probe touches a single word and verifies with key
+// bits the index did not use. Always-replace, one per search thread.
+class EvalHashTable {
+  std::vector<U64> slots;
+
+public:
+  static const size_t SIZE = 1 << 16; // 65536 slots, 512 KB
+
+  EvalHashTable() : slots(SIZE, 0) {}
+
+  void clear() { std::fill(slots.begin(), slots.end(), 0); }
+
+  bool probe(U64 key, int &eval) const {
+    U64 slot = slots[key & (SIZE - 1)];
+    if ((slot ^ key) >> 16)
+      return false;
+    eval = (int16_t)(slot & 0xFFFF);
+    return true;
+  }
+
+  void store(U64 key, int eval) {
+    slots[key & (SIZE - 1)] = (key & ~0xFFFFULL) | (uint16_t)eval;
+  }
+};
+
+#endif
@@ -1,4 +1,5 @@
 # main.py
+import os
 import sys
 import platform
 
@@ -41,6 +42,13 @@ ai_color = "b" if human_color == "w" else "w"
 
 chosen_depth = ui.show_depth_menu()  # 1-20
 ai = AlphaBetaEngine(depth=chosen_depth, time_limit=99999.0)  # No time limit
+ai.set_ponder(True)  # Keep thinking on the human's time
+if os.path.exists(resource_path("book.bin")):
+    ai.set_book(resource_path("book.bin"))  # Instant opening replies
+if os.path.isdir(resource_path("syzygy")):
+    ai.set_syzygy_path(resource_path("syzygy"))  # Perfect endgames
+if os.path.exists(resource_path("nn.nnue")):
+    ai.set_nnue(resource_path("nn.nnue"))  # Neural network evaluation
 screen.title("Chess: Human vs AI")
 
 # If human is black, flip the board so black is at bottom
@@ -68,15 +76,24 @@ def refresh_captured():
 
 # --- AI TURN HANDLER ---
 def play_ai_turn():
-    global last_move
     if engine.game_over:
         return
 
     screen.title("Chess - AI is thinking...")
     screen.update()
 
-    # AI decides
-    move = ai.get_best_move(engine)
+    # Search runs on a native thread; keep the UI responsive meanwhile
+    ai.start_search(engine)
+    screen.ontimer(finish_ai_turn, 50)
+
+
+def finish_ai_turn():
+    global last_move
+    if not ai.poll():
+        screen.ontimer(finish_ai_turn, 50)
+        return
+
+    move = ai.wait()
 
     if move:
         sr, sc, tr, tc = move
@@ -125,7 +142,8 @@ def play_ai_turn():
         ui.highlight_last_move(sr, sc, tr, tc)
 
         refresh_captured()
-        ui.update_status(engine.turn, engine.game_over, engine.winner)
+        ui.update_status(engine.turn, engine.game_over, engine.winner,
+                         engine.draw_reason)
         screen.title("Chess: Human vs AI")
         screen.update()
     else:
@@ -228,7 +246,8 @@ def on_click(x, y):
         capture_moves = []
 
         refresh_captured()
-        ui.update_status(engine.turn, engine.game_over, engine.winner)
+        ui.update_status(engine.turn, engine.game_over, engine.winner,
+                         engine.draw_reason)
         screen.update()
 
         # Trigger AI
@@ -243,7 +262,8 @@ def on_flip():
     if last_move:
         ui.redraw_last_move(*last_move)
     refresh_captured()
-    ui.update_status(engine.turn, engine.game_over, engine.winner)
+    ui.update_status(engine.turn, engine.game_over, engine.winner,
+                     engine.draw_reason)
     screen.update()
 
 
@@ -0,0 +1,102 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. Pages come straight from the
+// OS page cache, so every process mapping the same file shares one copy.
+class MappedFile {
+  const unsigned char *ptr = nullptr;
+  size_t bytes = 0;
+#if defined(_WIN32)
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#endif
+
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // False if the file cannot be opened or mapped. An empty file opens
+  // with no data.
+  bool open(const std::string &path) {
+    close();
+#if defined(_WIN32)
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) {
+      close();
+      return false;
+    }
+    bytes = (size_t)size.QuadPart;
+    if (bytes == 0)
+      return true;
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping)
+      ptr = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0,
+                                                 0);
+    if (!ptr) {
+      close();
+      return false;
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      if (fd >= 0)
+        ::close(fd);
+      return false;
+    }
+    bytes = (size_t)st.st_size;
+    if (bytes > 0) {
+      void *mem = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+      ptr = mem == MAP_FAILED ? nullptr : (const unsigned char *)mem;
+    }
+    ::close(fd); // the mapping keeps the file alive
+    if (bytes > 0 && !ptr) {
+      bytes = 0;
+      return false;
+    }
+#endif
+    return true;
+  }
+
+  void close() {
+#if defined(_WIN32)
+    if (ptr)
+      UnmapViewOfFile(ptr);
+    if (mapping)
+      CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (ptr)
+      munmap((void *)ptr, bytes);
+#endif
+    ptr = nullptr;
+    bytes = 0;
+  }
+
+  const unsigned char *data() const { return ptr; }
+  size_t size() const { return bytes; }
+};
+
+#endif
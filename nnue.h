@@ -0,0 +1,321 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bitboard.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <immintrin.h>
+#define NNUE_X86
+#define NNUE_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <immintrin.h>
+#include <intrin.h>
+#define NNUE_X86
+#define NNUE_TARGET_AVX2
+#endif
+
+using namespace std;
+
+// =============================================
+// NNUE EVALUATION
+// =============================================
+// HalfKP network in the Stockfish 12 .nnue format:
+//   41024 inputs (king square x non-king piece x square, per side)
+//   -> 2 x 256 accumulator -> 32 -> 32 -> 1
+// The first layer is a sum of weight rows, one per active feature, so
+// ChessEngine keeps it per ply and updates it with the pieces a move
+// changes. The rest runs on each evaluation with 8-bit activations.
+
+static const int NNUE_HALF = 256; // accumulator size per perspective
+static const int NNUE_FEATURES = 64 * 641;
+static const int NNUE_L1 = 32;
+static const int NNUE_L2 = 32;
+static const uint32_t NNUE_VERSION = 0x7AF32F16;
+
+// First-layer sums for both perspectives (indexed by color)
+struct alignas(32) NnueAccumulator {
+  int16_t v[2][NNUE_HALF];
+};
+
+enum NnueSimd { NNUE_SCALAR, NNUE_SSE2, NNUE_AVX2 };
+
+// Widest kernel set this CPU (and OS) supports, checked once per network
+static NnueSimd nnue_detect_simd() {
+#if defined(NNUE_X86) && defined(_MSC_VER)
+  int r[4];
+  __cpuid(r, 0);
+  if (r[0] < 7)
+    return NNUE_SSE2;
+  __cpuid(r, 1);
+  bool ymm_enabled = (r[2] & (1 << 27)) && (r[2] & (1 << 28)) &&
+                     (_xgetbv(0) & 6) == 6; // OSXSAVE, AVX, YMM state
+  __cpuidex(r, 7, 0);
+  return ymm_enabled && (r[1] & (1 << 5)) ? NNUE_AVX2 : NNUE_SSE2;
+#elif defined(NNUE_X86)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? NNUE_AVX2 : NNUE_SSE2;
+#else
+  return NNUE_SCALAR;
+#endif
+}
+
+static const char *nnue_simd_name(NnueSimd simd) {
+  return simd == NNUE_AVX2 ? "avx2" : simd == NNUE_SSE2 ? "sse2" : "scalar";
+}
+
+// --- Kernels: accumulator row add/sub (int16), accumulator clipping to
+// 0..127 (int16 -> uint8) and uint8 x int8 dot. Lengths are multiples of 32.
+
+static void nnue_add_row_scalar(int16_t *acc, const int16_t *w, bool add) {
+  for (int i = 0; i < NNUE_HALF; i++)
+    acc[i] += add ? w[i] : -w[i];
+}
+
+static void nnue_clip_scalar(uint8_t *out, const int16_t *acc) {
+  for (int i = 0; i < NNUE_HALF; i++)
+    out[i] = (uint8_t)max(0, min(127, (int)acc[i]));
+}
+
+static int nnue_dot_scalar(const uint8_t *in, const int8_t *w, int n) {
+  int sum = 0;
+  for (int i = 0; i < n; i++)
+    sum += in[i] * w[i];
+  return sum;
+}
+
+#if defined(NNUE_X86)
+static void nnue_add_row_sse2(int16_t *acc, const int16_t *w, bool add) {
+  for (int i = 0; i < NNUE_HALF; i += 8) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(acc + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(w + i));
+    a = add ? _mm_add_epi16(a, b) : _mm_sub_epi16(a, b);
+    _mm_storeu_si128((__m128i *)(acc + i), a);
+  }
+}
+
+static void nnue_clip_sse2(uint8_t *out, const int16_t *acc) {
+  const __m128i top = _mm_set1_epi16(127);
+  for (int i = 0; i < NNUE_HALF; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(acc + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(acc + i + 8));
+    // packus clamps negatives to 0
+    __m128i x =
+        _mm_packus_epi16(_mm_min_epi16(a, top), _mm_min_epi16(b, top));
+    _mm_storeu_si128((__m128i *)(out + i), x);
+  }
+}
+
+static int nnue_dot_sse2(const uint8_t *in, const int8_t *w, int n) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum = zero;
+  for (int i = 0; i < n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(w + i));
+    // Widen to int16: zero-extend inputs, sign-extend weights
+    __m128i x_lo = _mm_unpacklo_epi8(x, zero);
+    __m128i x_hi = _mm_unpackhi_epi8(x, zero);
+    __m128i y_lo = _mm_srai_epi16(_mm_unpacklo_epi8(y, y), 8);
+    __m128i y_hi = _mm_srai_epi16(_mm_unpackhi_epi8(y, y), 8);
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(x_lo, y_lo));
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(x_hi, y_hi));
+  }
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+  return _mm_cvtsi128_si32(sum);
+}
+
+NNUE_TARGET_AVX2 static void nnue_add_row_avx2(int16_t *acc, const int16_t *w,
+                                               bool add) {
+  for (int i = 0; i < NNUE_HALF; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(acc + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(w + i));
+    a = add ? _mm256_add_epi16(a, b) : _mm256_sub_epi16(a, b);
+    _mm256_storeu_si256((__m256i *)(acc + i), a);
+  }
+}
+
+NNUE_TARGET_AVX2 static void nnue_clip_avx2(uint8_t *out,
+                                            const int16_t *acc) {
+  const __m256i top = _mm256_set1_epi16(127);
+  for (int i = 0; i < NNUE_HALF; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(acc + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(acc + i + 16));
+    __m256i x = _mm256_packus_epi16(_mm256_min_epi16(a, top),
+                                    _mm256_min_epi16(b, top));
+    // packus works per 128-bit lane: restore the element order
+    x = _mm256_permute4x64_epi64(x, 0xD8);
+    _mm256_storeu_si256((__m256i *)(out + i), x);
+  }
+}
+
+// maddubs cannot saturate here: inputs are clipped to 0..127, so a pair
+// sums to at most 2 * 127 * 128
+NNUE_TARGET_AVX2 static int nnue_dot_avx2(const uint8_t *in, const int8_t *w,
+                                          int n) {
+  const __m256i ones = _mm256_set1_epi16(1);
+  __m256i sum = _mm256_setzero_si256();
+  for (int i = 0; i < n; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(in + i));
+    __m256i y = _mm256_loadu_si256((const __m256i *)(w + i));
+    __m256i pairs = _mm256_maddubs_epi16(x, y);
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(pairs, ones));
+  }
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                            _mm256_extracti128_si256(sum, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+  return _mm_cvtsi128_si32(s);
+}
+#endif
+
+class NnueNetwork {
+  vector<int16_t> ft_bias;    // [NNUE_HALF]
+  vector<int16_t> ft_weights; // [NNUE_FEATURES][NNUE_HALF]
+  int32_t l1_bias[NNUE_L1];
+  int8_t l1_weights[NNUE_L1][2 * NNUE_HALF];
+  int32_t l2_bias[NNUE_L2];
+  int8_t l2_weights[NNUE_L2][NNUE_L1];
+  int32_t out_bias;
+  int8_t out_weights[NNUE_L2];
+
+  // Raw little-endian arrays, as stored in the file (and in memory on
+  // every platform this builds for)
+  template <typename T>
+  static void read(ifstream &in, T *data, size_t count) {
+    in.read((char *)data, count * sizeof(T));
+  }
+
+  void row(int16_t *acc, int feature, bool add) const {
+    const int16_t *w = &ft_weights[(size_t)feature * NNUE_HALF];
+#if defined(NNUE_X86)
+    if (simd == NNUE_AVX2)
+      return nnue_add_row_avx2(acc, w, add);
+    if (simd == NNUE_SSE2)
+      return nnue_add_row_sse2(acc, w, add);
+#endif
+    nnue_add_row_scalar(acc, w, add);
+  }
+
+  void clip(uint8_t *out, const int16_t *acc) const {
+#if defined(NNUE_X86)
+    if (simd == NNUE_AVX2)
+      return nnue_clip_avx2(out, acc);
+    if (simd == NNUE_SSE2)
+      return nnue_clip_sse2(out, acc);
+#endif
+    nnue_clip_scalar(out, acc);
+  }
+
+  int dot(const uint8_t *in, const int8_t *w, int n) const {
+#if defined(NNUE_X86)
+    if (simd == NNUE_AVX2)
+      return nnue_dot_avx2(in, w, n);
+    if (simd == NNUE_SSE2)
+      return nnue_dot_sse2(in, w, n);
+#endif
+    return nnue_dot_scalar(in, w, n);
+  }
+
+public:
+  NnueSimd simd = nnue_detect_simd(); // may be lowered, e.g. for testing
+
+  explicit NnueNetwork(const string &path) {
+    ifstream in(path, ios::binary);
+    if (!in)
+      throw runtime_error("Cannot open NNUE network: " + path);
+
+    uint32_t version = 0, hash, desc_len = 0;
+    read(in, &version, 1);
+    read(in, &hash, 1);
+    read(in, &desc_len, 1);
+    in.seekg(desc_len, ios::cur); // free-form description
+    read(in, &hash, 1);           // feature transformer
+    ft_bias.resize(NNUE_HALF);
+    ft_weights.resize((size_t)NNUE_FEATURES * NNUE_HALF);
+    read(in, ft_bias.data(), ft_bias.size());
+    read(in, ft_weights.data(), ft_weights.size());
+    read(in, &hash, 1); // hidden layers
+    read(in, l1_bias, NNUE_L1);
+    read(in, &l1_weights[0][0], sizeof(l1_weights));
+    read(in, l2_bias, NNUE_L2);
+    read(in, &l2_weights[0][0], sizeof(l2_weights));
+    read(in, &out_bias, 1);
+    read(in, out_weights, NNUE_L2);
+
+    // Any other architecture has a different size
+    if (!in || version != NNUE_VERSION || in.peek() != EOF)
+      throw runtime_error("Not a HalfKP 256x2-32-32 NNUE network: " + path);
+  }
+
+  // Load `path`, or share it if the process already has it loaded
+  static shared_ptr<NnueNetwork> open_shared(const string &path) {
+    static mutex lock;
+    static map<string, weak_ptr<NnueNetwork>> loaded;
+    lock_guard<mutex> guard(lock);
+    shared_ptr<NnueNetwork> net = loaded[path].lock();
+    if (!net) {
+      net = make_shared<NnueNetwork>(path);
+      loaded[path] = net;
+    }
+    return net;
+  }
+
+  // Feature of a non-king piece seen from `perspective`, whose king is on
+  // `ksq`. Our squares have a8 = 0: ^ 56 gives the a1 = 0 numbering of
+  // the file, and black's view is additionally rotated (^ 63).
+  static int feature(int perspective, int ksq, int color, int type, int sq) {
+    int orient = perspective == WHITE ? 56 : 7;
+    return (sq ^ orient) + 1 + 128 * type + 64 * (color != perspective) +
+           641 * (ksq ^ orient);
+  }
+
+  // Rebuild one perspective of an accumulator from the board
+  void refresh(const U64 pieces[2][6], int perspective, int16_t *acc) const {
+    memcpy(acc, ft_bias.data(), NNUE_HALF * sizeof(int16_t));
+    int ksq = bb_ctzll(pieces[perspective][K]);
+    for (int color = 0; color < 2; color++)
+      for (int type = P; type < K; type++)
+        for (U64 bb = pieces[color][type]; bb; bb &= bb - 1)
+          row(acc, feature(perspective, ksq, color, type, bb_ctzll(bb)), true);
+  }
+
+  void add(int16_t *acc, int feature) const { row(acc, feature, true); }
+  void sub(int16_t *acc, int feature) const { row(acc, feature, false); }
+
+  // Score in centipawns for the side to move
+  int evaluate(const NnueAccumulator &acc, int stm) const {
+    alignas(32) uint8_t input[2 * NNUE_HALF];
+    clip(input, acc.v[stm]);
+    clip(input + NNUE_HALF, acc.v[stm ^ 1]);
+
+    // Hidden layers: affine, then clipped ReLU back to 0..127 (the
+    // weights carry 6 fractional bits)
+    alignas(32) uint8_t h1[NNUE_L1], h2[NNUE_L2];
+    for (int i = 0; i < NNUE_L1; i++) {
+      int v = l1_bias[i] + dot(input, l1_weights[i], 2 * NNUE_HALF);
+      h1[i] = (uint8_t)max(0, min(127, v >> 6));
+    }
+    for (int i = 0; i < NNUE_L2; i++) {
+      int v = l2_bias[i] + dot(h1, l2_weights[i], NNUE_L1);
+      h2[i] = (uint8_t)max(0, min(127, v >> 6));
+    }
+    int out = out_bias + dot(h2, out_weights, NNUE_L2);
+
+    // Output is in 1/16 of the trainer's units, where a pawn is 208.
+    // Scaled in one division, so only the final centipawn is truncated.
+    return out * 100 / (16 * 208);
+  }
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef PAWN_HASH_H
+#define PAWN_HASH_H
+
+#include <cstring>
+#include <vector>
+
+#include "bitboard.h"
+
+// Cached pawn-structure analysis for one pawn configuration. Scores and
+// bitboards are per color, so the entry is independent of the side to move.
+struct PawnEntry {
+  U64 key;
+  U64 passed[2];  // passed pawns
+  U64 attacks[2]; // squares attacked by pawns
+  int score[2];   // doubled / isolated / passed terms
+};
+
+// Direct-mapped, always-replace table indexed by ChessEngine::pawn_key.
+// Each search thread owns one, so it needs no synchronisation. A cleared
+// slot has key 0, which is also the key (and the correct, all-zero entry)
+// of a position without pawns.
+class PawnHashTable {
+  std::vector<PawnEntry> entries;
+
+public:
+  static const size_t SIZE = 1 << 13; // 8192 entries, 384 KB
+
+  PawnHashTable() : entries(SIZE) { clear(); }
+
+  void clear() { memset((void *)entries.data(), 0, SIZE * sizeof(PawnEntry)); }
+
+  // The slot for `key`; the caller fills it when entry.key != key
+  PawnEntry &slot(U64 key) { return entries[key & (SIZE - 1)]; }
+};
+
+#endif
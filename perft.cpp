@@ -0,0 +1,128 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// =============================================
+// PERFT — move generator correctness and speed
+// =============================================
+// Counts the leaf nodes of the legal move tree to a fixed depth. Leaves are
+// bulk counted (depth 1 returns the legal move count without making the
+// moves), subtrees can be cached in a hash table keyed by the Zobrist key,
+// and root moves can be split across threads, each on its own board copy.
+
+// Lockless perft hash: the key is stored XORed with the data so a torn
+// write from another thread is rejected instead of returning a bogus count
+class PerftHash {
+  struct Entry {
+    atomic<U64> check{0}; // zobrist key ^ data
+    atomic<U64> data{0};  // nodes << 8 | depth
+  };
+  unique_ptr<Entry[]> table;
+  U64 mask = 0;
+
+public:
+  explicit PerftHash(size_t mb) {
+    size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= mb * 1024 * 1024)
+      count *= 2;
+    table.reset(new Entry[count]);
+    mask = count - 1;
+  }
+
+  bool probe(U64 key, int depth, U64 &nodes) const {
+    const Entry &e = table[key & mask];
+    U64 data = e.data.load(memory_order_relaxed);
+    U64 check = e.check.load(memory_order_relaxed);
+    if ((check ^ data) != key || (int)(data & 0xFF) != depth)
+      return false;
+    nodes = data >> 8;
+    return true;
+  }
+
+  void store(U64 key, int depth, U64 nodes) {
+    Entry &e = table[key & mask];
+    U64 data = (nodes << 8) | (U64)depth;
+    e.check.store(key ^ data, memory_order_relaxed);
+    e.data.store(data, memory_order_relaxed);
+  }
+};
+
+static U64 perft_nodes(ChessEngine &engine, int depth, PerftHash *hash) {
+  if (depth == 0)
+    return 1;
+  U64 nodes = 0;
+  if (depth > 1 && hash && hash->probe(engine.hash_key, depth, nodes))
+    return nodes;
+
+  MoveList moves;
+  engine.get_legal_moves(moves);
+  if (depth == 1)
+    return moves.count;
+
+  for (Move m : moves) {
+    engine.make_move_fast(m);
+    nodes += perft_nodes(engine, depth - 1, hash);
+    engine.unmake_move(m);
+  }
+
+  if (hash)
+    hash->store(engine.hash_key, depth, nodes);
+  return nodes;
+}
+
+// Node count below each root move, in generation order. Root moves are
+// handed out to worker threads one at a time, so uneven subtrees balance.
+static vector<pair<string, U64>> perft_divide(ChessEngine &engine, int depth,
+                                              int threads, int hash_mb) {
+  py::gil_scoped_release release;
+
+  MoveList moves;
+  engine.get_legal_moves(moves);
+  vector<U64> counts(moves.count, 0);
+  unique_ptr<PerftHash> hash(hash_mb > 0 ? new PerftHash(hash_mb) : nullptr);
+
+  if (depth >= 1) {
+    atomic<int> next{0};
+    auto worker = [&]() {
+      ChessEngine board = engine;
+      for (int i; (i = next.fetch_add(1)) < moves.count;) {
+        board.make_move_fast(moves.moves[i]);
+        counts[i] = perft_nodes(board, depth - 1, hash.get());
+        board.unmake_move(moves.moves[i]);
+      }
+    };
+
+    int n = max(1, min(threads, moves.count));
+    vector<thread> pool;
+    for (int t = 1; t < n; t++)
+      pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool)
+      t.join();
+  }
+
+  vector<pair<string, U64>> result;
+  for (int i = 0; i < moves.count; i++)
+    result.push_back({move_to_uci(moves.moves[i]), counts[i]});
+  return result;
+}
+
+static U64 perft(ChessEngine &engine, int depth, int threads, int hash_mb) {
+  if (depth <= 0)
+    return 1;
+  U64 total = 0;
+  for (auto &entry : perft_divide(engine, depth, threads, hash_mb))
+    total += entry.second;
+  return total;
+}
+
+#endif
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""
+Perft driver for the C++ move generator.
+Counts the leaf nodes of the legal move tree to a fixed depth and reports
+the node count and speed, optionally split per root move (divide).
+
+Usage:
+    python perft.py 5
+    python perft.py 6 --divide --threads 4 --hash 64
+    python perft.py 4 --fen "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"
+    python perft.py --suite
+"""
+
+import argparse
+import sys
+import time
+
+from chess_engine_cpp import ChessEngine, perft, perft_divide
+
+# Standard perft positions with known node counts: (fen, depth, nodes)
+PERFT_SUITE = [
+    ("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+     6, 119060324),
+    ("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+     5, 193690690),
+    ("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+     6, 11030083),
+    ("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+     5, 15833292),
+    ("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+     5, 89941194),
+    ("r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+     5, 164075551),
+]
+
+
+def run_suite(threads, hash_mb):
+    """Run every suite position, check its node count and report NPS."""
+    engine = ChessEngine()
+    total = 0
+    elapsed = 0.0
+    failed = 0
+    for fen, depth, expected in PERFT_SUITE:
+        engine.set_fen(fen)
+        start = time.perf_counter()
+        nodes = perft(engine, depth, threads, hash_mb)
+        elapsed += time.perf_counter() - start
+        total += nodes
+        if nodes != expected:
+            failed += 1
+        status = "OK  " if nodes == expected else "FAIL"
+        print(f"{status} d{depth} {nodes:>11} (expected {expected})  {fen}")
+    nps = total / elapsed if elapsed > 0 else 0
+    print(f"\nNodes: {total}  Time: {elapsed:.3f}s  NPS: {nps:,.0f}")
+    return failed == 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Move generator perft")
+    parser.add_argument("depth", type=int, nargs="?", default=5,
+                        help="search depth in plies (default 5)")
+    parser.add_argument("--fen", help="start position (default: initial)")
+    parser.add_argument("--suite", action="store_true",
+                        help="run the standard positions and check counts")
+    parser.add_argument("--divide", action="store_true",
+                        help="print the node count below each root move")
+    parser.add_argument("--threads", type=int, default=1,
+                        help="split root moves across this many threads")
+    parser.add_argument("--hash", type=int, default=0, metavar="MB",
+                        help="perft hash table size in MB (0 = off)")
+    args = parser.parse_args()
+
+    if args.suite:
+        sys.exit(0 if run_suite(args.threads, args.hash) else 1)
+
+    engine = ChessEngine()
+    if args.fen:
+        engine.set_fen(args.fen)
+    start = time.perf_counter()
+    if args.divide:
+        counts = perft_divide(engine, args.depth, args.threads, args.hash)
+        for move, nodes in counts:
+            print(f"{move}: {nodes}")
+        total = sum(nodes for _, nodes in counts)
+    else:
+        total = perft(engine, args.depth, args.threads, args.hash)
+    elapsed = time.perf_counter() - start
+
+    nps = total / elapsed if elapsed > 0 else 0
+    print(f"\nNodes: {total}  Time: {elapsed:.3f}s  NPS: {nps:,.0f}")
+
+
+if __name__ == "__main__":
+    main()
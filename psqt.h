@@ -0,0 +1,65 @@
+#ifndef PSQT_H
+#define PSQT_H
+
+#include "bitboard.h"
+
+// Material and piece-square tables, shared by the evaluation and the
+// incremental accumulators in ChessEngine. Tables are indexed from
+// White's point of view (a8 = 0); black pieces use the square ^ 56.
+
+// Piece values
+static const int PIECE_VALUE[6] = {100, 320, 330, 500, 900, 20000};
+
+// --- Piece-Square Tables ---
+const int PST_P[64] = {0,   0,  0,  0,   0,  0,  0,   0,  50, 50, 50, 50, 50,
+                       50,  50, 50, 10,  10, 20, 30,  30, 20, 10, 10, 5,  5,
+                       10,  25, 25, 10,  5,  5,  0,   0,  0,  20, 20, 0,  0,
+                       0,   5,  -5, -10, 0,  0,  -10, -5, 5,  5,  10, 10, -20,
+                       -20, 10, 10, 5,   0,  0,  0,   0,  0,  0,  0,  0};
+
+const int PST_N[64] = {-50, -40, -30, -30, -30, -30, -40, -50, -40, -20, 0,
+                       0,   0,   0,   -20, -40, -30, 0,   10,  15,  15,  10,
+                       0,   -30, -30, 5,   15,  20,  20,  15,  5,   -30, -30,
+                       0,   15,  20,  20,  15,  0,   -30, -30, 5,   10,  15,
+                       15,  10,  5,   -30, -40, -20, 0,   5,   5,   0,   -20,
+                       -40, -50, -40, -30, -30, -30, -30, -40, -50};
+
+const int PST_B[64] = {-20, -10, -10, -10, -10, -10, -10, -20, -10, 0,   0,
+                       0,   0,   0,   0,   -10, -10, 0,   5,   10,  10,  5,
+                       0,   -10, -10, 5,   5,   10,  10,  5,   5,   -10, -10,
+                       0,   10,  10,  10,  10,  0,   -10, -10, 10,  10,  10,
+                       10,  10,  10,  -10, -10, 5,   0,   0,   0,   0,   5,
+                       -10, -20, -10, -10, -10, -10, -10, -10, -20};
+
+const int PST_R[64] = {0,  0, 0, 0, 0, 0, 0, 0,  5,  10, 10, 10, 10, 10, 10, 5,
+                       -5, 0, 0, 0, 0, 0, 0, -5, -5, 0,  0,  0,  0,  0,  0,  -5,
+                       -5, 0, 0, 0, 0, 0, 0, -5, -5, 0,  0,  0,  0,  0,  0,  -5,
+                       0,  0, 0, 5, 5, 0, 0, 0,  0,  5,  5,  0,  0,  5,  5,  0};
+
+const int PST_Q[64] = {
+    -20, -10, -10, -5, -5, -10, -10, -20, -10, 0,   0,   0,  0,  0,   0,   -10,
+    -10, 0,   5,   5,  5,  5,   0,   -10, -5,  0,   5,   5,  5,  5,   0,   -5,
+    0,   0,   5,   5,  5,  5,   0,   -5,  -10, 5,   5,   5,  5,  5,   0,   -10,
+    -10, 0,   5,   0,  0,  0,   0,   -10, -20, -10, -10, -5, -5, -10, -10, -20};
+
+const int PST_K_mid[64] = {
+    -30, -40, -40, -50, -50, -40, -40, -30, -30, -40, -40, -50, -50,
+    -40, -40, -30, -30, -40, -40, -50, -50, -40, -40, -30, -30, -40,
+    -40, -50, -50, -40, -40, -30, -20, -30, -30, -40, -40, -30, -30,
+    -20, -10, -20, -20, -20, -20, -20, -20, -10, 20,  20,  0,   0,
+    0,   0,   20,  20,  20,  30,  10,  0,   0,   10,  30,  20};
+
+const int PST_K_end[64] = {
+    -50, -40, -30, -20, -20, -30, -40, -50, -30, -20, -10, 0,   0,
+    -10, -20, -30, -30, -10, 20,  30,  30,  20,  -10, -30, -30, -10,
+    30,  40,  40,  30,  -10, -30, -30, -10, 30,  40,  40,  30,  -10,
+    -30, -30, -10, 20,  30,  30,  20,  -10, -30, -30, -30, 0,   0,
+    0,   0,   -30, -30, -50, -30, -30, -30, -30, -30, -30, -50};
+
+// Per piece type: the midgame and endgame tables differ only for the king
+static const int *const PST_MG[6] = {PST_P, PST_N, PST_B,
+                                     PST_R, PST_Q, PST_K_mid};
+static const int *const PST_EG[6] = {PST_P, PST_N, PST_B,
+                                     PST_R, PST_Q, PST_K_end};
+
+#endif
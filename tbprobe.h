@@ -0,0 +1,954 @@
+#ifndef TBPROBE_H
+#define TBPROBE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.h"
+
+using namespace std;
+
+// =============================================
+// SYZYGY TABLEBASES
+// =============================================
+// WDL (.rtbw) and DTZ (.rtbz) probing of Syzygy files found in a list of
+// local directories. The registry is process-wide: every engine shares the
+// same tables, and each file is memory-mapped on its first probe. Loading
+// new paths publishes a new registry; searches keep the one they started
+// with alive until they finish.
+// Include after ChessEngine: probes make and unmake moves on it.
+//
+// Tables index positions from white's point of view, squares a1 = 0 to
+// h8 = 63 and pieces coded as color * 8 + (P..K = 1..6); the board is
+// converted on every probe.
+
+static const int TB_PIECES = 7;
+
+// WDL scores, from the side to move's point of view. Cursed wins and
+// blessed losses are decided by the fifty-move rule: they are draws.
+static const int TB_LOSS = -2;
+static const int TB_BLESSED_LOSS = -1;
+static const int TB_DRAW = 0;
+static const int TB_CURSED_WIN = 1;
+static const int TB_WIN = 2;
+
+// Probe outcome
+static const int TB_FAIL = 0;
+static const int TB_OK = 1;
+static const int TB_CHANGE_STM = -1;        // DTZ stored for the other side
+static const int TB_ZEROING_BEST_MOVE = 2; // best move zeroes the counter
+
+// Per-table flags stored in the file
+static const int TB_FLAG_STM = 1;
+static const int TB_FLAG_MAPPED = 2;
+static const int TB_FLAG_WIN_PLIES = 4;
+static const int TB_FLAG_LOSS_PLIES = 8;
+static const int TB_FLAG_WIDE = 16;
+static const int TB_FLAG_SINGLE_VALUE = 128;
+
+static inline unsigned tb_le16(const uint8_t *p) { return p[0] | p[1] << 8; }
+static inline uint32_t tb_le32(const uint8_t *p) {
+  return tb_le16(p) | (uint32_t)tb_le16(p + 2) << 16;
+}
+static inline uint32_t tb_be32(const uint8_t *p) {
+  return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+static inline U64 tb_be64(const uint8_t *p) {
+  return (U64)tb_be32(p) << 32 | tb_be32(p + 4);
+}
+
+static inline int tb_rank(int sq) { return sq >> 3; }
+static inline int tb_file(int sq) { return sq & 7; }
+// Distance above the a1-h8 diagonal (negative below it)
+static inline int tb_off_diag(int sq) { return tb_rank(sq) - tb_file(sq); }
+
+// Our bitboards have a8 = 0; mirroring the ranks gives the a1 = 0 order
+static inline U64 tb_flip_ranks(U64 bb) {
+  bb = ((bb >> 8) & 0x00FF00FF00FF00FFULL) |
+       ((bb & 0x00FF00FF00FF00FFULL) << 8);
+  bb = ((bb >> 16) & 0x0000FFFF0000FFFFULL) |
+       ((bb & 0x0000FFFF0000FFFFULL) << 16);
+  return (bb >> 32) | (bb << 32);
+}
+
+// Index encoding tables, built once
+struct TBIndexTables {
+  int map_pawns[64];
+  int map_b1h1h7[64];
+  int map_a1d1d4[64];
+  int map_kk[10][64];
+  int binomial[6][64];
+  int lead_pawn_idx[6][64];
+  int lead_pawns_size[6][4];
+
+  TBIndexTables() {
+    memset(this, 0, sizeof(*this));
+
+    // Squares below the a1-h8 diagonal -> 0..27
+    int code = 0;
+    for (int s = 0; s < 64; s++)
+      if (tb_off_diag(s) < 0)
+        map_b1h1h7[s] = code++;
+
+    // a1-d1-d4 triangle -> 0..9, diagonal squares last
+    vector<int> diagonal;
+    code = 0;
+    for (int s = 0; s <= 27; s++) {
+      if (tb_off_diag(s) < 0 && tb_file(s) <= 3)
+        map_a1d1d4[s] = code++;
+      else if (!tb_off_diag(s) && tb_file(s) <= 3)
+        diagonal.push_back(s);
+    }
+    for (int s : diagonal)
+      map_a1d1d4[s] = code++;
+
+    // The 462 legal king pairs with the first king in the triangle; if it
+    // is on the diagonal the second must not be above it. Pairs with both
+    // kings on the diagonal come last.
+    vector<pair<int, int>> both_on_diagonal;
+    code = 0;
+    for (int idx = 0; idx < 10; idx++)
+      for (int s1 = 0; s1 <= 27; s1++) {
+        if (map_a1d1d4[s1] != idx || (!idx && s1 != 1)) // b1 maps to 0
+          continue;
+        for (int s2 = 0; s2 < 64; s2++) {
+          U64 adjacent = king_attacks[s1 ^ 56] | (1ULL << (s1 ^ 56));
+          if (adjacent & (1ULL << (s2 ^ 56)))
+            continue;
+          if (!tb_off_diag(s1) && tb_off_diag(s2) > 0)
+            continue;
+          if (!tb_off_diag(s1) && !tb_off_diag(s2))
+            both_on_diagonal.push_back({idx, s2});
+          else
+            map_kk[idx][s2] = code++;
+        }
+      }
+    for (auto &p : both_on_diagonal)
+      map_kk[p.first][p.second] = code++;
+
+    // binomial[k][n]: ways to choose k of n squares
+    binomial[0][0] = 1;
+    for (int n = 1; n < 64; n++)
+      for (int k = 0; k < 6 && k <= n; k++)
+        binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) +
+                         (k < n ? binomial[k][n - 1] : 0);
+
+    // map_pawns: a2-h7 -> 0..47, highest for the pawn that leads (nearest
+    // the edge, then lowest rank). Lead pawn tables are split by file.
+    int available = 47;
+    for (int cnt = 1; cnt <= 5; cnt++)
+      for (int f = 0; f < 4; f++) {
+        int idx = 0;
+        for (int r = 1; r <= 6; r++) {
+          int sq = r * 8 + f;
+          if (cnt == 1) {
+            map_pawns[sq] = available--;
+            map_pawns[sq ^ 7] = available--;
+          }
+          lead_pawn_idx[cnt][sq] = idx;
+          idx += binomial[cnt - 1][map_pawns[sq]];
+        }
+        lead_pawns_size[cnt][f] = idx;
+      }
+  }
+};
+
+static const TBIndexTables &tb_index() {
+  static const TBIndexTables tables;
+  return tables;
+}
+
+// One compressed sub-table: values are stored as canonical Huffman codes
+// of "recursive pairing" symbols, each expanding to 1..256 values, in
+// fixed-size blocks. A sparse index locates the block holding an index.
+struct TBPairs {
+  int flags = 0;
+  int max_sym_len = 0;
+  int min_sym_len = 0; // or the value, for single-value tables
+  uint32_t num_blocks = 0;
+  size_t block_size = 0;
+  size_t span = 0;
+  const uint8_t *lowest_sym = nullptr;   // LE uint16 per code length
+  const uint8_t *btree = nullptr;        // 3 bytes per symbol: left, right
+  const uint8_t *block_length = nullptr; // LE uint16 per block
+  uint32_t block_length_size = 0;
+  const uint8_t *sparse_index = nullptr; // 6 bytes: LE32 block, LE16 offset
+  size_t sparse_index_size = 0;
+  const uint8_t *data = nullptr;
+  vector<U64> base64;
+  vector<uint8_t> symlen; // values represented by a symbol, minus one
+  int pieces[TB_PIECES] = {};
+  U64 group_idx[TB_PIECES + 1] = {};
+  int group_len[TB_PIECES + 1] = {};
+  uint16_t map_idx[4] = {}; // DTZ value maps: win, loss, cursed, blessed
+
+  int sym_left(int sym) const {
+    const uint8_t *p = btree + 3 * sym;
+    return ((p[1] & 0xF) << 8) | p[0];
+  }
+  int sym_right(int sym) const {
+    const uint8_t *p = btree + 3 * sym;
+    return (p[2] << 4) | (p[1] >> 4);
+  }
+
+  int decompress(U64 idx) const {
+    if (flags & TB_FLAG_SINGLE_VALUE)
+      return min_sym_len;
+
+    // The sparse entry nearest idx gives a block and an offset in it;
+    // walk blocks from there until the offset falls inside one
+    uint32_t k = (uint32_t)(idx / span);
+    const uint8_t *sparse = sparse_index + 6 * (size_t)k;
+    uint32_t block = tb_le32(sparse);
+    int offset = (int)tb_le16(sparse + 4);
+    offset += (int)(idx % span) - (int)(span / 2);
+    while (offset < 0)
+      offset += (int)tb_le16(block_length + 2 * --block) + 1;
+    while (offset > (int)tb_le16(block_length + 2 * block))
+      offset -= (int)tb_le16(block_length + 2 * block++) + 1;
+
+    const uint8_t *ptr = data + (U64)block * block_size;
+    U64 buf64 = tb_be64(ptr);
+    ptr += 8;
+    int buf64_size = 64;
+    int sym;
+    for (;;) {
+      int len = 0; // code length - min_sym_len
+      while (buf64 < base64[len])
+        len++;
+      sym = (int)((buf64 - base64[len]) >> (64 - len - min_sym_len));
+      sym += tb_le16(lowest_sym + 2 * len);
+      if (offset < symlen[sym] + 1)
+        break;
+      offset -= symlen[sym] + 1;
+      len += min_sym_len;
+      buf64 <<= len;
+      buf64_size -= len;
+      if (buf64_size <= 32) {
+        buf64_size += 32;
+        buf64 |= (U64)tb_be32(ptr) << (64 - buf64_size);
+        ptr += 4;
+      }
+    }
+
+    // Expand the pair tree down to the single value at `offset`
+    while (symlen[sym]) {
+      int left = sym_left(sym);
+      if (offset < symlen[left] + 1) {
+        sym = left;
+      } else {
+        offset -= symlen[left] + 1;
+        sym = sym_right(sym);
+      }
+    }
+    return sym_left(sym);
+  }
+};
+
+// A WDL or DTZ file for one material balance, e.g. KRPvKR. key is the
+// material signature with white on the first side of the name, key2 with
+// colors swapped.
+struct TBTable {
+  bool dtz = false;
+  string name;
+  U64 key = 0, key2 = 0;
+  int piece_count = 0;
+  bool has_pawns = false;
+  bool has_unique_pieces = false;
+  int pawn_count[2] = {0, 0}; // [lead color, other color]
+
+  atomic<bool> ready{false};
+  bool available = false;
+  MappedFile file;
+  const uint8_t *map = nullptr; // DTZ value maps
+  TBPairs items[2][4];          // [side to move][lead pawn file a-d]
+
+  TBPairs *get(int stm, int f) {
+    return &items[dtz ? 0 : stm % 2][has_pawns ? f : 0];
+  }
+};
+
+// Material signature: 4 bits per color and piece type, kings excluded
+static U64 tb_material_key(const int counts[2][6]) {
+  U64 key = 0;
+  for (int c = 0; c < 2; c++)
+    for (int t = P; t < K; t++)
+      key |= (U64)counts[c][t] << (4 * (6 * c + t));
+  return key;
+}
+
+static U64 tb_material_key(const ChessEngine &pos) {
+  int counts[2][6];
+  for (int c = 0; c < 2; c++)
+    for (int t = P; t < K; t++)
+      counts[c][t] = count_bits(pos.pieces[c][t]);
+  return tb_material_key(counts);
+}
+
+class SyzygyTablebases {
+  vector<unique_ptr<TBTable>> tables;
+  unordered_map<U64, pair<TBTable *, TBTable *>> by_key; // WDL, DTZ
+  vector<string> dirs;
+  int largest = 0;
+  mutex map_lock;
+
+  static shared_ptr<SyzygyTablebases> &published() {
+    static shared_ptr<SyzygyTablebases> tb = make_shared<SyzygyTablebases>();
+    return tb;
+  }
+
+  static int dtz_before_zeroing(int wdl) {
+    return wdl == TB_WIN           ? 1
+           : wdl == TB_CURSED_WIN  ? 101
+           : wdl == TB_BLESSED_LOSS ? -101
+           : wdl == TB_LOSS        ? -1
+                                   : 0;
+  }
+
+  static int sign_of(int v) { return (v > 0) - (v < 0); }
+
+  // Parse a file name like KRPvKR; false if it is not a table name
+  static bool parse_name(const string &name, int counts[2][6]) {
+    static const string PIECE_CHARS = "PNBRQK";
+    memset(counts, 0, sizeof(int) * 12);
+    size_t v = name.find('v');
+    if (v == string::npos || name.size() < 3 || name[0] != 'K' ||
+        v + 1 >= name.size() || name[v + 1] != 'K')
+      return false;
+    for (size_t i = 0; i < name.size(); i++) {
+      if (i == v)
+        continue;
+      size_t t = PIECE_CHARS.find(name[i]);
+      if (t == string::npos)
+        return false;
+      counts[i > v][t]++;
+    }
+    return counts[0][K] == 1 && counts[1][K] == 1;
+  }
+
+  void add(const string &name) {
+    int counts[2][6];
+    if (!parse_name(name, counts))
+      return;
+    int swapped[2][6];
+    for (int t = 0; t < 6; t++) {
+      swapped[0][t] = counts[1][t];
+      swapped[1][t] = counts[0][t];
+    }
+    U64 key = tb_material_key(counts);
+    if (by_key.count(key))
+      return; // already found in an earlier directory
+
+    TBTable *pair_tables[2];
+    for (int dtz = 0; dtz < 2; dtz++) {
+      TBTable *e = new TBTable();
+      tables.emplace_back(e);
+      e->dtz = dtz;
+      e->name = name;
+      e->key = key;
+      e->key2 = tb_material_key(swapped);
+      e->piece_count = 0;
+      for (int c = 0; c < 2; c++)
+        for (int t = 0; t < 6; t++) {
+          e->piece_count += counts[c][t];
+          if (t != K && counts[c][t] == 1)
+            e->has_unique_pieces = true;
+        }
+      int wp = counts[WHITE][P], bp = counts[BLACK][P];
+      e->has_pawns = wp + bp > 0;
+      // The lead color is the one with fewer pawns (better compression)
+      bool white_leads = !bp || (wp && bp >= wp);
+      e->pawn_count[0] = white_leads ? wp : bp;
+      e->pawn_count[1] = white_leads ? bp : wp;
+      pair_tables[dtz] = e;
+    }
+    by_key[key] = by_key[pair_tables[0]->key2] = {pair_tables[0],
+                                                  pair_tables[1]};
+    largest = max(largest, pair_tables[0]->piece_count);
+  }
+
+  // Group pieces that are indexed together: the leading group (3 unique
+  // pieces, the two kings, or the lead pawns), then runs of identical
+  // pieces. order[] gives the position of the leading group and of the
+  // other side's pawns in the mixed-radix index.
+  static void set_groups(TBTable &e, TBPairs *d, const int order[2], int f) {
+    const TBIndexTables &ix = tb_index();
+    int n = 0;
+    int first_len = e.has_pawns ? 0 : e.has_unique_pieces ? 3 : 2;
+    d->group_len[n] = 1;
+    for (int i = 1; i < e.piece_count; i++) {
+      if (--first_len > 0 || d->pieces[i] == d->pieces[i - 1])
+        d->group_len[n]++;
+      else
+        d->group_len[++n] = 1;
+    }
+    d->group_len[++n] = 0;
+
+    bool pp = e.has_pawns && e.pawn_count[1]; // pawns on both sides
+    int next = pp ? 2 : 1;
+    int free_squares = 64 - d->group_len[0] - (pp ? d->group_len[1] : 0);
+    U64 idx = 1;
+    for (int k = 0; next < n || k == order[0] || k == order[1]; k++) {
+      if (k == order[0]) {
+        d->group_idx[0] = idx;
+        idx *= e.has_pawns           ? ix.lead_pawns_size[d->group_len[0]][f]
+               : e.has_unique_pieces ? 31332
+                                     : 462;
+      } else if (k == order[1]) {
+        d->group_idx[1] = idx;
+        idx *= ix.binomial[d->group_len[1]][48 - d->group_len[0]];
+      } else {
+        d->group_idx[next] = idx;
+        idx *= ix.binomial[d->group_len[next]][free_squares];
+        free_squares -= d->group_len[next++];
+      }
+    }
+    d->group_idx[n] = idx;
+  }
+
+  static int set_symlen(TBPairs *d, int s, vector<bool> &visited) {
+    visited[s] = true; // the pair tree is acyclic
+    int sr = d->sym_right(s);
+    if (sr == 0xFFF)
+      return 0;
+    int sl = d->sym_left(s);
+    if (!visited[sl])
+      d->symlen[sl] = (uint8_t)set_symlen(d, sl, visited);
+    if (!visited[sr])
+      d->symlen[sr] = (uint8_t)set_symlen(d, sr, visited);
+    return d->symlen[sl] + d->symlen[sr] + 1;
+  }
+
+  static const uint8_t *set_sizes(TBPairs *d, const uint8_t *data) {
+    d->flags = *data++;
+    if (d->flags & TB_FLAG_SINGLE_VALUE) {
+      d->min_sym_len = *data++; // the value itself
+      return data;
+    }
+
+    int n = 0;
+    while (d->group_len[n])
+      n++;
+    U64 tb_size = d->group_idx[n];
+
+    d->block_size = (size_t)1 << *data++;
+    d->span = (size_t)1 << *data++;
+    d->sparse_index_size = (size_t)((tb_size + d->span - 1) / d->span);
+    int padding = *data++;
+    d->num_blocks = tb_le32(data);
+    data += 4;
+    // Padded so the sparse index never points past the end
+    d->block_length_size = d->num_blocks + padding;
+    d->max_sym_len = *data++;
+    d->min_sym_len = *data++;
+    d->lowest_sym = data;
+
+    // Canonical Huffman: longer codes have lower values. base64[l] is the
+    // lowest code of length min_sym_len + l, left-aligned in 64 bits.
+    size_t lengths = d->max_sym_len - d->min_sym_len + 1;
+    d->base64.assign(lengths, 0);
+    for (int i = (int)lengths - 2; i >= 0; i--)
+      d->base64[i] = (d->base64[i + 1] + tb_le16(d->lowest_sym + 2 * i) -
+                      tb_le16(d->lowest_sym + 2 * (i + 1))) /
+                     2;
+    for (size_t i = 0; i < lengths; i++)
+      d->base64[i] <<= 64 - i - d->min_sym_len;
+    data += lengths * 2;
+
+    d->symlen.assign(tb_le16(data), 0);
+    data += 2;
+    d->btree = data;
+    vector<bool> visited(d->symlen.size());
+    for (size_t s = 0; s < d->symlen.size(); s++)
+      if (!visited[s])
+        d->symlen[s] = (uint8_t)set_symlen(d, (int)s, visited);
+    return data + d->symlen.size() * 3 + (d->symlen.size() & 1);
+  }
+
+  static const uint8_t *set_dtz_map(TBTable &e, const uint8_t *data,
+                                    int max_file) {
+    e.map = data;
+    for (int f = 0; f <= max_file; f++) {
+      TBPairs *d = e.get(0, f);
+      if (!(d->flags & TB_FLAG_MAPPED))
+        continue;
+      if (d->flags & TB_FLAG_WIDE) {
+        data += (uintptr_t)data & 1; // 16-bit maps are word aligned
+        for (int i = 0; i < 4; i++) {
+          d->map_idx[i] = (uint16_t)((data - e.map) / 2 + 1);
+          data += 2 * tb_le16(data) + 2;
+        }
+      } else {
+        for (int i = 0; i < 4; i++) {
+          d->map_idx[i] = (uint16_t)(data - e.map + 1);
+          data += *data + 1;
+        }
+      }
+    }
+    return data + ((uintptr_t)data & 1);
+  }
+
+  // Lay the sub-tables over the mapped file (after the 4-byte magic)
+  static void set_tables(TBTable &e, const uint8_t *data) {
+    data++; // flags: split, has pawns
+    int sides = !e.dtz && e.key != e.key2 ? 2 : 1;
+    int max_file = e.has_pawns ? 3 : 0;
+    bool pp = e.has_pawns && e.pawn_count[1];
+
+    for (int f = 0; f <= max_file; f++) {
+      for (int i = 0; i < sides; i++)
+        *e.get(i, f) = TBPairs();
+      int order[2][2] = {{data[0] & 0xF, pp ? data[1] & 0xF : 0xF},
+                         {data[0] >> 4, pp ? data[1] >> 4 : 0xF}};
+      data += 1 + pp;
+      for (int k = 0; k < e.piece_count; k++, data++)
+        for (int i = 0; i < sides; i++)
+          e.get(i, f)->pieces[k] = i ? *data >> 4 : *data & 0xF;
+      for (int i = 0; i < sides; i++)
+        set_groups(e, e.get(i, f), order[i], f);
+    }
+    data += (uintptr_t)data & 1;
+
+    for (int f = 0; f <= max_file; f++)
+      for (int i = 0; i < sides; i++)
+        data = set_sizes(e.get(i, f), data);
+    if (e.dtz)
+      data = set_dtz_map(e, data, max_file);
+    for (int f = 0; f <= max_file; f++)
+      for (int i = 0; i < sides; i++) {
+        TBPairs *d = e.get(i, f);
+        d->sparse_index = data;
+        data += d->sparse_index_size * 6;
+      }
+    for (int f = 0; f <= max_file; f++)
+      for (int i = 0; i < sides; i++) {
+        TBPairs *d = e.get(i, f);
+        d->block_length = data;
+        data += d->block_length_size * 2;
+      }
+    for (int f = 0; f <= max_file; f++)
+      for (int i = 0; i < sides; i++) {
+        TBPairs *d = e.get(i, f);
+        data = (const uint8_t *)(((uintptr_t)data + 0x3F) & ~(uintptr_t)0x3F);
+        d->data = data;
+        data += (size_t)d->num_blocks * d->block_size;
+      }
+  }
+
+  // Map the file on first use; safe to call from several search threads
+  bool mapped(TBTable &e) {
+    if (e.ready.load(memory_order_acquire))
+      return e.available;
+    lock_guard<mutex> guard(map_lock);
+    if (e.ready.load(memory_order_relaxed))
+      return e.available;
+
+    static const uint8_t MAGIC[2][4] = {{0x71, 0xE8, 0x23, 0x5D},
+                                        {0xD7, 0x66, 0x0C, 0xA5}};
+    string file_name = e.name + (e.dtz ? ".rtbz" : ".rtbw");
+    for (const string &dir : dirs) {
+      if (!e.file.open((filesystem::path(dir) / file_name).string()))
+        continue;
+      const uint8_t *data = e.file.data();
+      if (e.file.size() > 16 && !memcmp(data, MAGIC[e.dtz], 4)) {
+        set_tables(e, data + 4);
+        e.available = true;
+        break;
+      }
+      e.file.close(); // corrupt or wrong type
+    }
+    e.ready.store(true, memory_order_release);
+    return e.available;
+  }
+
+  // Stored value of the position: WDL score, or DTZ in plies
+  int probe_table(ChessEngine &pos, TBTable &e, int wdl, int &result) {
+    const TBIndexTables &ix = tb_index();
+    auto pawns_comp = [&ix](int a, int b) {
+      return ix.map_pawns[a] < ix.map_pawns[b];
+    };
+    int squares[TB_PIECES], pieces[TB_PIECES];
+    int size = 0, lead_pawns_cnt = 0, next = 0, tb_f = 0;
+    U64 lead_pawns = 0, idx;
+
+    // Tables are stored with the stronger side as white, and symmetric
+    // ones only with white to move: otherwise swap colors and flip ranks
+    bool flip = (e.key == e.key2 && pos.turn_col == BLACK) ||
+                tb_material_key(pos) != e.key;
+    int flip_color = flip * 8, flip_squares = flip * 56;
+    int stm = flip ^ pos.turn_col;
+
+    if (e.has_pawns) {
+      // The lead pawns are the first pieces of every pawn sub-table
+      int lead_color = (e.get(0, 0)->pieces[0] ^ flip_color) >> 3;
+      U64 b = lead_pawns = tb_flip_ranks(pos.pieces[lead_color][P]);
+      while (b) {
+        squares[size++] = get_ls1b(b) ^ flip_squares;
+        b &= b - 1;
+      }
+      lead_pawns_cnt = size;
+      swap(squares[0],
+           *max_element(squares, squares + lead_pawns_cnt, pawns_comp));
+      tb_f = min(tb_file(squares[0]), 7 - tb_file(squares[0]));
+    }
+
+    // DTZ is one-sided: it may only be stored for the other side to move
+    if (e.dtz) {
+      int flags = e.get(stm, tb_f)->flags;
+      if ((flags & TB_FLAG_STM) != stm && !(e.key == e.key2 && !e.has_pawns)) {
+        result = TB_CHANGE_STM;
+        return 0;
+      }
+    }
+
+    for (U64 b = tb_flip_ranks(pos.occupied) ^ lead_pawns; b; b &= b - 1) {
+      int s = get_ls1b(b);
+      int pc = pos.board[s ^ 56];
+      squares[size] = s ^ flip_squares;
+      pieces[size++] = (piece_color(pc) * 8 + piece_type(pc) + 1) ^ flip_color;
+    }
+
+    TBPairs *d = e.get(stm, tb_f);
+
+    // Put the pieces in the table's order
+    for (int i = lead_pawns_cnt; i < size - 1; i++)
+      for (int j = i + 1; j < size; j++)
+        if (d->pieces[i] == pieces[j]) {
+          swap(pieces[i], pieces[j]);
+          swap(squares[i], squares[j]);
+          break;
+        }
+
+    // Mirror so the lead piece is on files a-d
+    if (tb_file(squares[0]) > 3)
+      for (int i = 0; i < size; i++)
+        squares[i] ^= 7;
+
+    if (e.has_pawns) {
+      idx = ix.lead_pawn_idx[lead_pawns_cnt][squares[0]];
+      stable_sort(squares + 1, squares + lead_pawns_cnt, pawns_comp);
+      for (int i = 1; i < lead_pawns_cnt; i++)
+        idx += ix.binomial[i][ix.map_pawns[squares[i]]];
+    } else {
+      // Pawnless: also mirror to ranks 1-4, then below the a1-h8 diagonal
+      if (tb_rank(squares[0]) > 3)
+        for (int i = 0; i < size; i++)
+          squares[i] ^= 56;
+      for (int i = 0; i < d->group_len[0]; i++) {
+        if (!tb_off_diag(squares[i]))
+          continue;
+        if (tb_off_diag(squares[i]) > 0)
+          for (int j = i; j < size; j++)
+            squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+        break;
+      }
+
+      if (e.has_unique_pieces) {
+        // Three unique pieces indexed together (31332 combinations)
+        int adjust1 = squares[1] > squares[0];
+        int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+        if (tb_off_diag(squares[0]))
+          idx = ((U64)ix.map_a1d1d4[squares[0]] * 63 +
+                 (squares[1] - adjust1)) *
+                    62 +
+                squares[2] - adjust2;
+        else if (tb_off_diag(squares[1]))
+          idx = (6 * 63 + tb_rank(squares[0]) * 28 +
+                 ix.map_b1h1h7[squares[1]]) *
+                    62 +
+                squares[2] - adjust2;
+        else if (tb_off_diag(squares[2]))
+          idx = 6 * 63 * 62 + 4 * 28 * 62 + tb_rank(squares[0]) * 7 * 28 +
+                (tb_rank(squares[1]) - adjust1) * 28 +
+                ix.map_b1h1h7[squares[2]];
+        else
+          idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 +
+                tb_rank(squares[0]) * 7 * 6 +
+                (tb_rank(squares[1]) - adjust1) * 6 +
+                (tb_rank(squares[2]) - adjust2);
+      } else {
+        // Only the two kings lead (462 combinations)
+        idx = ix.map_kk[ix.map_a1d1d4[squares[0]]][squares[1]];
+      }
+    }
+
+    // Remaining groups: combinations of squares, skipping squares taken
+    // by earlier groups (and the pawn ranks for the other side's pawns)
+    idx *= d->group_idx[0];
+    int *group_sq = squares + d->group_len[0];
+    bool remaining_pawns = e.has_pawns && e.pawn_count[1];
+    while (d->group_len[++next]) {
+      stable_sort(group_sq, group_sq + d->group_len[next]);
+      U64 n = 0;
+      for (int i = 0; i < d->group_len[next]; i++) {
+        int adjust = 0;
+        for (int *s = squares; s < group_sq; s++)
+          adjust += group_sq[i] > *s;
+        n += ix.binomial[i + 1][group_sq[i] - adjust - 8 * remaining_pawns];
+      }
+      remaining_pawns = false;
+      idx += n * d->group_idx[next];
+      group_sq += d->group_len[next];
+    }
+
+    int value = d->decompress(idx);
+    if (!e.dtz)
+      return value - 2;
+
+    // DTZ values are remapped by frequency per WDL class, and may be
+    // stored in moves rather than plies
+    static const int WDL_MAP[] = {1, 3, 0, 2, 0};
+    int flags = e.get(0, tb_f)->flags;
+    if (flags & TB_FLAG_MAPPED) {
+      int at = e.get(0, tb_f)->map_idx[WDL_MAP[wdl + 2]] + value;
+      value = flags & TB_FLAG_WIDE ? tb_le16(e.map + 2 * at) : e.map[at];
+    }
+    if ((wdl == TB_WIN && !(flags & TB_FLAG_WIN_PLIES)) ||
+        (wdl == TB_LOSS && !(flags & TB_FLAG_LOSS_PLIES)) ||
+        wdl == TB_CURSED_WIN || wdl == TB_BLESSED_LOSS)
+      value *= 2;
+    return value + 1;
+  }
+
+  int probe(ChessEngine &pos, bool dtz, int wdl, int &result) {
+    if (count_bits(pos.occupied) == 2)
+      return TB_DRAW; // KvK
+    auto it = by_key.find(tb_material_key(pos));
+    if (it == by_key.end()) {
+      result = TB_FAIL;
+      return 0;
+    }
+    TBTable &e = dtz ? *it->second.second : *it->second.first;
+    if (!mapped(e)) {
+      result = TB_FAIL;
+      return 0;
+    }
+    return probe_table(pos, e, wdl, result);
+  }
+
+  // Tables may hold any value where the side to move has a winning
+  // capture (or, for DTZ, a winning pawn move), so those moves are tried
+  // first and the best of them and the stored value is the result
+  int search(ChessEngine &pos, int &result, bool check_zeroing) {
+    int best = TB_LOSS, value;
+    MoveList moves;
+    pos.get_legal_moves(moves);
+    int tried = 0;
+    for (Move m : moves) {
+      if (!move_is_capture(m) &&
+          (!check_zeroing || pos.piece_at(pos.turn_col, move_from(m)) != P))
+        continue;
+      tried++;
+      pos.make_move_fast(m);
+      value = -search(pos, result, false);
+      pos.unmake_move(m);
+      if (result == TB_FAIL)
+        return TB_DRAW;
+      if (value > best) {
+        best = value;
+        if (value >= TB_WIN) {
+          result = TB_ZEROING_BEST_MOVE;
+          return value;
+        }
+      }
+    }
+
+    // With every legal move tried the stored value is not needed (and is
+    // wrong for en passant positions, which the tables do not cover)
+    bool no_more_moves = tried && tried == moves.count;
+    if (no_more_moves) {
+      value = best;
+    } else {
+      value = probe(pos, false, TB_DRAW, result);
+      if (result == TB_FAIL)
+        return TB_DRAW;
+    }
+    if (best >= value) {
+      result = best > TB_DRAW || no_more_moves ? TB_ZEROING_BEST_MOVE : TB_OK;
+      return best;
+    }
+    result = TB_OK;
+    return value;
+  }
+
+public:
+  // The registry new searches use
+  static shared_ptr<SyzygyTablebases> current() {
+    return atomic_load(&published());
+  }
+
+  // Build a registry from `paths` and make it the current one; returns
+  // how many tables were found. Safe while searches run: they keep
+  // probing the registry they took until they finish.
+  static int load(const string &paths) {
+    auto tb = make_shared<SyzygyTablebases>();
+    int found = tb->init(paths);
+    atomic_store(&published(), tb);
+    return found;
+  }
+
+  // Register every table found in `paths` (directories separated by ';'
+  // on Windows, ':' elsewhere) and return how many were found. Only for a
+  // registry no search can see yet: see load().
+  int init(const string &paths) {
+    tables.clear();
+    by_key.clear();
+    dirs.clear();
+    largest = 0;
+#if defined(_WIN32)
+    const char SEP = ';';
+#else
+    const char SEP = ':';
+#endif
+    size_t start = 0;
+    while (start <= paths.size()) {
+      size_t end = paths.find(SEP, start);
+      if (end == string::npos)
+        end = paths.size();
+      if (end > start)
+        dirs.push_back(paths.substr(start, end - start));
+      start = end + 1;
+    }
+
+    int found = 0;
+    for (const string &dir : dirs) {
+      error_code ec;
+      for (filesystem::directory_iterator it(dir, ec), end; !ec && it != end;
+           it.increment(ec)) {
+        filesystem::path p = it->path();
+        if (p.extension() != ".rtbw")
+          continue;
+        size_t before = by_key.size();
+        add(p.stem().string());
+        found += by_key.size() != before;
+      }
+    }
+    return found;
+  }
+
+  // Most pieces (kings included) of any table found, 0 if none
+  int max_pieces() const { return largest; }
+
+  // WDL score of the position, for the side to move
+  int probe_wdl(ChessEngine &pos, int &result) {
+    result = TB_OK;
+    return search(pos, result, false);
+  }
+
+  // Plies to the next capture or pawn move on the optimal path, signed by
+  // the WDL result (positive when winning); 0 for draws
+  int probe_dtz(ChessEngine &pos, int &result) {
+    result = TB_OK;
+    int wdl = search(pos, result, true);
+    if (result == TB_FAIL || wdl == TB_DRAW)
+      return 0;
+    if (result == TB_ZEROING_BEST_MOVE)
+      return dtz_before_zeroing(wdl);
+
+    int dtz = probe(pos, true, wdl, result);
+    if (result == TB_FAIL)
+      return 0;
+    if (result != TB_CHANGE_STM)
+      return (dtz + 100 * (wdl == TB_BLESSED_LOSS || wdl == TB_CURSED_WIN)) *
+             sign_of(wdl);
+
+    // Stored for the other side: one ply of search for the best DTZ
+    int min_dtz = 0xFFFF;
+    MoveList moves;
+    pos.get_legal_moves(moves);
+    for (Move m : moves) {
+      bool zeroing = move_is_capture(m) ||
+                     pos.piece_at(pos.turn_col, move_from(m)) == P;
+      pos.make_move_fast(m);
+      dtz = zeroing ? -dtz_before_zeroing(search(pos, result, false))
+                    : -probe_dtz(pos, result);
+      if (dtz == 1 && pos.in_check_col(pos.turn_col)) {
+        MoveList replies;
+        pos.get_legal_moves(replies);
+        if (replies.count == 0)
+          min_dtz = 1; // mate
+      }
+      if (!zeroing)
+        dtz += sign_of(dtz);
+      if (dtz < min_dtz && sign_of(dtz) == sign_of(wdl))
+        min_dtz = dtz;
+      pos.unmake_move(m);
+      if (result == TB_FAIL)
+        return 0;
+    }
+    return min_dtz == 0xFFFF ? -1 : min_dtz; // no moves: mated
+  }
+
+  // Root moves that keep the tablebase result: the fastest conversion
+  // when winning, the longest resistance when losing, any draw when
+  // drawn. Uses DTZ, or WDL when the DTZ file is missing; empty if the
+  // position is not covered.
+  vector<Move> root_moves(ChessEngine &pos) {
+    vector<Move> keep;
+    if (!largest || count_bits(pos.occupied) > largest || pos.castling)
+      return keep;
+    MoveList moves;
+    pos.get_legal_moves(moves);
+    vector<int> value(moves.count);
+    int result = TB_OK;
+
+    bool use_dtz = true;
+    for (int pass = 0; pass < 2; pass++) {
+      for (int i = 0; i < moves.count; i++) {
+        Move m = moves.moves[i];
+        pos.make_move_fast(m);
+        int v;
+        if (!use_dtz) {
+          v = -probe_wdl(pos, result);
+        } else if (pos.halfmove_clock == 0) {
+          v = dtz_before_zeroing(-probe_wdl(pos, result));
+        } else {
+          v = -probe_dtz(pos, result);
+          v += sign_of(v);
+        }
+        if (use_dtz && pos.in_check_col(pos.turn_col) && v == 2) {
+          MoveList replies;
+          pos.get_legal_moves(replies);
+          if (replies.count == 0)
+            v = 1; // mate
+        }
+        pos.unmake_move(m);
+        if (result == TB_FAIL)
+          break;
+        value[i] = v;
+      }
+      if (result != TB_FAIL)
+        break;
+      if (!use_dtz)
+        return keep;
+      use_dtz = false; // retry with WDL only
+      result = TB_OK;
+    }
+
+    // Rank: any win beats any draw beats any loss; among wins the lowest
+    // DTZ, among losses the highest. WDL values already run from loss to
+    // win, with cursed wins and blessed losses next to the draw.
+    auto rank = [use_dtz](int v) {
+      if (!use_dtz)
+        return v;
+      return v > 0 ? 0x10000 - v : v < 0 ? -0x10000 - v : 0;
+    };
+    int best = -0x20000;
+    for (int i = 0; i < moves.count; i++)
+      best = max(best, rank(value[i]));
+    for (int i = 0; i < moves.count; i++)
+      if (rank(value[i]) == best)
+        keep.push_back(moves.moves[i]);
+    return keep;
+  }
+};
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef TT_H
+#define TT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "bitboard.h"
+
+#if defined(_WIN32)
+#include <malloc.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+static const int TT_EXACT = 0;
+static const int TT_ALPHA = 1;
+static const int TT_BETA = 2;
+
+// Static eval field of an entry that has none
+static const int TT_NO_EVAL = -32768;
+
+// Packed 16-byte entry: the Zobrist key plus one data word
+//   bits  0-15  best move (NO_MOVE if none was found)
+//   bits 16-31  score (int16)
+//   bits 32-47  static eval (int16, TT_NO_EVAL if not computed)
+//   bits 48-55  depth
+//   bits 56-57  bound (TT_EXACT / TT_ALPHA / TT_BETA)
+//   bits 58-63  generation of the search that wrote it
+struct TTEntry {
+  U64 key;
+  U64 data;
+
+  Move move() const { return (Move)(data & 0xFFFF); }
+  int score() const { return (int16_t)(data >> 16); }
+  int eval() const { return (int16_t)(data >> 32); }
+  int depth() const { return (int)((data >> 48) & 0xFF); }
+  int flag() const { return (int)((data >> 56) & 3); }
+  int generation() const { return (int)(data >> 58); }
+};
+
+// Stored form of an entry, shared by all search threads without locks. The
+// key is kept XORed with the data, so if two threads race on a slot and a
+// reader sees one thread's key word with the other's data word, the key no
+// longer verifies and the probe is a miss rather than a wrong result.
+struct TTSlot {
+  std::atomic<U64> check; // key ^ data
+  std::atomic<U64> data;
+
+  TTEntry load() const {
+    U64 d = data.load(std::memory_order_relaxed);
+    return {check.load(std::memory_order_relaxed) ^ d, d};
+  }
+  void save(U64 key, U64 d) {
+    check.store(key ^ d, std::memory_order_relaxed);
+    data.store(d, std::memory_order_relaxed);
+  }
+};
+
+// Four entries fill one 64-byte cache line, so a probe touches one line
+static const int TT_BUCKET_SIZE = 4;
+struct alignas(64) TTBucket {
+  TTSlot entries[TT_BUCKET_SIZE];
+};
+
+// Fixed-size transposition table: a power-of-two array of buckets indexed
+// by the low bits of the key. Entries are never cleared during a search;
+// store() overwrites the least useful slot of the bucket, preferring
+// shallow entries and entries left over from earlier searches.
+class TranspositionTable {
+  TTBucket *buckets = nullptr;
+  size_t bucket_count = 0;
+  size_t alloc_bytes = 0;
+  int generation = 0; // 6 bits, bumped once per search
+
+  static void *alloc_table(size_t bytes) {
+#if defined(_WIN32)
+    return _aligned_malloc(bytes, 64);
+#else
+    void *mem = nullptr;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    // Align to 2 MB so the kernel can back the table with huge pages,
+    // which cuts TLB misses on random probes
+    const size_t HUGE_PAGE = 2 * 1024 * 1024;
+    if (bytes >= HUGE_PAGE && posix_memalign(&mem, HUGE_PAGE, bytes) == 0) {
+      madvise(mem, bytes, MADV_HUGEPAGE);
+      return mem;
+    }
+#endif
+    return posix_memalign(&mem, 64, bytes) == 0 ? mem : nullptr;
+#endif
+  }
+
+  static void free_table(void *mem) {
+#if defined(_WIN32)
+    _aligned_free(mem);
+#else
+    free(mem);
+#endif
+  }
+
+  TTBucket &bucket(U64 key) const {
+    return buckets[key & (bucket_count - 1)];
+  }
+
+public:
+  explicit TranspositionTable(size_t mb = 16) { resize(mb); }
+  ~TranspositionTable() { free_table(buckets); }
+  TranspositionTable(const TranspositionTable &) = delete;
+  TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+  // Size in MB, rounded down to a power-of-two number of buckets
+  void resize(size_t mb) {
+    size_t count = 1;
+    while (count * 2 * sizeof(TTBucket) <= std::max<size_t>(mb, 1) << 20)
+      count *= 2;
+    if (count != bucket_count) {
+      free_table(buckets);
+      bucket_count = count;
+      alloc_bytes = count * sizeof(TTBucket);
+      buckets = (TTBucket *)alloc_table(alloc_bytes);
+      if (!buckets)
+        throw std::bad_alloc();
+    }
+    clear();
+  }
+
+  size_t size_mb() const { return alloc_bytes >> 20; }
+
+  void clear() {
+    memset((void *)buckets, 0, alloc_bytes);
+    generation = 0;
+  }
+
+  void new_search() { generation = (generation + 1) & 63; }
+
+  // Pull the bucket for `key` into cache ahead of the probe
+  void prefetch(U64 key) const {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(&bucket(key));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch((const char *)&bucket(key), _MM_HINT_T0);
+#endif
+  }
+
+  // Copy the entry for `key` into `entry`; false if there is none
+  bool probe(U64 key, TTEntry &entry) const {
+    TTBucket &b = bucket(key);
+    for (auto &slot : b.entries) {
+      TTEntry e = slot.load();
+      if (e.key == key && e.data) {
+        entry = e;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // A fail-low node has no best move; it keeps the move already stored for
+  // the same position rather than erasing it. The static eval is kept the
+  // same way when the caller did not compute one.
+  void store(U64 key, int score, int depth, int flag, Move move,
+             int eval = TT_NO_EVAL) {
+    TTBucket &b = bucket(key);
+    TTSlot *slot = &b.entries[0];
+    int slot_worth = 1 << 30;
+    for (auto &s : b.entries) {
+      TTEntry e = s.load();
+      if (e.key == key || !e.data) {
+        // Keep a deeper result from this search unless the new one is exact
+        if (e.data && flag != TT_EXACT && e.generation() == generation &&
+            depth < e.depth() - 2)
+          return;
+        if (move == NO_MOVE && e.key == key)
+          move = e.move();
+        if (eval == TT_NO_EVAL && e.key == key)
+          eval = e.eval();
+        slot = &s;
+        break;
+      }
+      int age = (generation - e.generation()) & 63;
+      int worth = e.depth() - 8 * age;
+      if (worth < slot_worth) {
+        slot_worth = worth;
+        slot = &s;
+      }
+    }
+
+    score = std::max(-32000, std::min(32000, score));
+    depth = std::min(std::max(depth, 0), 255);
+    slot->save(key, (U64)move | ((U64)(uint16_t)score << 16) |
+                        ((U64)(uint16_t)eval << 32) | ((U64)depth << 48) |
+                        ((U64)flag << 56) | ((U64)generation << 58));
+  }
+
+  // Permille of sampled entries written by the current search (UCI hashfull)
+  int hashfull() const {
+    size_t sample = std::min<size_t>(bucket_count, 1000 / TT_BUCKET_SIZE);
+    int used = 0;
+    for (size_t i = 0; i < sample; i++)
+      for (auto &slot : buckets[i].entries) {
+        TTEntry e = slot.load();
+        if (e.data && e.generation() == generation)
+          used++;
+      }
+    return (int)(used * 1000 / (sample * TT_BUCKET_SIZE));
+  }
+};
+
+#endif
@@ -49,7 +49,8 @@ class ChessUI:
         self.status_text.goto(0, 375)
         self.status_text.color("white")
 
-    def update_status(self, turn, game_over=False, winner=None):
+    def update_status(self, turn, game_over=False, winner=None,
+                      draw_reason=None):
         self.status_text.clear()
         if game_over:
             # Re-create turtle so it renders on top of everything (fixes Windows visibility)
@@ -60,7 +61,8 @@ class ChessUI:
             self.status_text.goto(0, 375)
 
             if winner == "draw":
-                text = "GAME OVER — STALEMATE (DRAW)"
+                reason = (draw_reason or "stalemate").upper()
+                text = f"GAME OVER — {reason} (DRAW)"
                 self.status_text.color("#FFD700")
             elif winner == "w":
                 text = "CHECKMATE — WHITE WINS!"